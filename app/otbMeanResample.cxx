@@ -23,6 +23,19 @@
 #include "otbMultiToMonoChannelExtractROI.h"
 #include "otbMeanResampleImageFilter.h"
 
+// Batch mode
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "otbImageIOFactory.h"
+#include "otbImageInformationMutex.h"
+#include "otbClampImageFilter.h"
+#include "itkDirectory.h"
+#include "itkMultiThreader.h"
+#include "itksys/SystemTools.hxx"
+
+#include <algorithm>
+#include <map>
+
 using namespace std;
 
 namespace otb
@@ -44,6 +57,28 @@ public:
 
   typedef otb::MeanResampleImageFilter<FloatImageType> FilterType;
 
+  typedef otb::ImageFileReader<FloatVectorImageType> ReaderType;
+
+  /** One image of the batch */
+  struct BatchJobType
+  {
+    string inFileName;
+    string outFileName;
+    string error;
+    unsigned long redundantRequestedBytes;
+  };
+
+  /** Data shared by the batch threads */
+  struct BatchThreadStruct
+  {
+    vector<BatchJobType> * Jobs;
+    unsigned int           NumberOfThreadsPerImage;
+    unsigned int           RAMPerImage;
+    unsigned int           StepX;
+    unsigned int           StepY;
+    string                 PixelType;
+  };
+
   /** Standard macro */
   itkNewMacro(Self);
   itkTypeMacro(MeanResample, Application);
@@ -55,7 +90,12 @@ public:
     SetDescription("Resample an image using the mean value of the pixels over a square neighborhood");
 
     // Documentation
-    SetDocLongDescription("This application decimates an input image using the mean value of the pixels neighborhood");
+    SetDocLongDescription("This application decimates an input image using the mean value of the pixels neighborhood. "
+        "In batch mode (batch.il or batch.dir), all the input images are processed in the same process, "
+        "and written using the batch.out naming pattern. Up to batch.nbconcurrent images are processed "
+        "concurrently, sharing the available threads and RAM, and written with the batch.pixtype "
+        "pixel type. Images which fail are reported without stopping the batch, then the "
+        "application fails if any image failed.");
     SetDocLimitations("None");
     SetDocAuthors("Remi Cresson");
     SetDocSeeAlso(" ");
@@ -64,6 +104,7 @@ public:
 
     AddParameter(ParameterType_InputImage,   "in",  "Input XS Image");
     SetParameterDescription("in"," Input image.");
+    MandatoryOff("in");
 
     AddParameter(ParameterType_Int, "stepx", "step x" );
     SetMinimumParameterIntValue("stepx", 2);
@@ -74,6 +115,32 @@ public:
 
     AddParameter(ParameterType_OutputImage,  "out",   "Output image");
     SetParameterDescription("out"," Output image.");
+    MandatoryOff("out");
+
+    AddParameter(ParameterType_Group, "batch", "Batch mode");
+    AddParameter(ParameterType_InputFilenameList, "batch.il", "Input images list");
+    MandatoryOff("batch.il");
+    AddParameter(ParameterType_Directory, "batch.dir", "Input images directory");
+    MandatoryOff("batch.dir");
+    AddParameter(ParameterType_String, "batch.out", "Output naming pattern");
+    SetParameterDescription("batch.out", "%s is replaced by the input file name without extension "
+        "(default: %s_resampled.tif).");
+    MandatoryOff("batch.out");
+    AddParameter(ParameterType_Choice, "batch.pixtype", "Output pixel type");
+    SetParameterDescription("batch.pixtype", "Pixel type of the output images (values are clamped "
+        "to the range of the type).");
+    AddChoice("batch.pixtype.float", "float");
+    AddChoice("batch.pixtype.uint8", "uint8");
+    AddChoice("batch.pixtype.int16", "int16");
+    AddChoice("batch.pixtype.uint16", "uint16");
+    AddChoice("batch.pixtype.int32", "int32");
+    AddChoice("batch.pixtype.uint32", "uint32");
+    AddChoice("batch.pixtype.double", "double");
+    MandatoryOff("batch.pixtype");
+    AddParameter(ParameterType_Int, "batch.nbconcurrent", "Number of concurrent images");
+    SetMinimumParameterIntValue("batch.nbconcurrent", 1);
+    SetDefaultParameterInt("batch.nbconcurrent", 1);
+    MandatoryOff("batch.nbconcurrent");
 
     AddRAMParameter();
 
@@ -91,9 +158,248 @@ public:
     // Nothing to do here : all parameters are independent
   }
 
+  /*
+   * Returns the input images of the batch
+   */
+  vector<string> GetBatchInputs()
+  {
+    vector<string> inputs;
+    if (HasValue("batch.il"))
+      {
+      inputs = GetParameterStringList("batch.il");
+      }
+    if (HasValue("batch.dir"))
+      {
+      string dirName = GetParameterString("batch.dir");
+      if (dirName[dirName.size()-1] != '/')
+        {
+        dirName.append("/");
+        }
+      itk::Directory::Pointer dir = itk::Directory::New();
+      if (!dir->Load(dirName.c_str()))
+        {
+        otbAppLogFATAL("Unable to browse directory " << dirName);
+        }
+      vector<string> filenames;
+      for (unsigned int i = 0; i < dir->GetNumberOfFiles(); i++)
+        {
+        string filename = dirName + string(dir->GetFile(i));
+        otb::ImageIOBase::Pointer imageIO =
+            otb::ImageIOFactory::CreateImageIO(filename.c_str(),otb::ImageIOFactory::ReadMode);
+        if (imageIO.IsNotNull())
+          {
+          filenames.push_back(filename);
+          }
+        }
+      std::sort(filenames.begin(), filenames.end());
+      inputs.insert(inputs.end(), filenames.begin(), filenames.end());
+      }
+    return inputs;
+  }
+
+  /*
+   * Returns the output filename of an input image
+   */
+  string GetBatchOutput(const string & inFileName)
+  {
+    string outFileName = "%s_resampled.tif";
+    if (HasValue("batch.out"))
+      {
+      outFileName = GetParameterString("batch.out");
+      }
+    const string name = itksys::SystemTools::GetFilenameWithoutLastExtension(inFileName);
+    size_t pos = outFileName.find("%s");
+    if (pos == string::npos)
+      {
+      otbAppLogFATAL("The output naming pattern must contain %s");
+      }
+    outFileName.replace(pos, 2, name);
+    return outFileName;
+  }
+
+  /*
+   * Resamples one image of the batch
+   */
+  static void ProcessBatchJob(BatchJobType & job, const BatchThreadStruct & str)
+  {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(job.inFileName);
+    ImageInformationMutex::UpdateOutputInformation(reader.GetPointer());
+
+    ExtractFilterType::Pointer extractFilter = ExtractFilterType::New();
+    extractFilter->SetInput(reader->GetOutput());
+    extractFilter->SetChannel(1);
+    extractFilter->SetNumberOfThreads(str.NumberOfThreadsPerImage);
+
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetStepX(str.StepX);
+    filter->SetStepY(str.StepY);
+    filter->SetInput(extractFilter->GetOutput());
+    filter->SetNumberOfThreads(str.NumberOfThreadsPerImage);
+
+    if (str.PixelType == "uint8")
+      WriteBatchOutput<unsigned char>(filter->GetOutput(), job, str);
+    else if (str.PixelType == "int16")
+      WriteBatchOutput<short>(filter->GetOutput(), job, str);
+    else if (str.PixelType == "uint16")
+      WriteBatchOutput<unsigned short>(filter->GetOutput(), job, str);
+    else if (str.PixelType == "int32")
+      WriteBatchOutput<int>(filter->GetOutput(), job, str);
+    else if (str.PixelType == "uint32")
+      WriteBatchOutput<unsigned int>(filter->GetOutput(), job, str);
+    else if (str.PixelType == "double")
+      WriteBatchOutput<double>(filter->GetOutput(), job, str);
+    else
+      WriteBatchOutput<float>(filter->GetOutput(), job, str);
+
+    job.redundantRequestedBytes = filter->GetRedundantRequestedBytes();
+  }
+
+  /*
+   * Writes the resampled image of a batch job with the given pixel type
+   */
+  template <class TPixel>
+  static void WriteBatchOutput(FloatImageType * image, const BatchJobType & job, const BatchThreadStruct & str)
+  {
+    typedef otb::Image<TPixel> OutputImageType;
+    typedef otb::ClampImageFilter<FloatImageType, OutputImageType> ClampFilterType;
+    typedef otb::ImageFileWriter<OutputImageType> WriterType;
+
+    typename ClampFilterType::Pointer clampFilter = ClampFilterType::New();
+    clampFilter->SetInput(image);
+    clampFilter->SetNumberOfThreads(str.NumberOfThreadsPerImage);
+
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetFileName(job.outFileName);
+    writer->SetInput(clampFilter->GetOutput());
+    writer->SetAutomaticAdaptativeStreaming(str.RAMPerImage);
+    writer->Update();
+  }
+
+  /*
+   * Static function used as a "callback" by the MultiThreader to process
+   * the batch
+   */
+  static ITK_THREAD_RETURN_TYPE BatchThreaderCallback(void *arg)
+  {
+    itk::MultiThreader::ThreadInfoStruct * info =
+        static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+    BatchThreadStruct * str = static_cast<BatchThreadStruct *>(info->UserData);
+
+    // Each thread processes one image over NumberOfThreads
+    for (unsigned int i = info->ThreadID; i < str->Jobs->size(); i += info->NumberOfThreads)
+      {
+      BatchJobType & job = (*str->Jobs)[i];
+      try
+        {
+        ProcessBatchJob(job, *str);
+        }
+      catch (itk::ExceptionObject & err)
+        {
+        job.error = err.GetDescription();
+        }
+      catch (std::exception & err)
+        {
+        job.error = err.what();
+        }
+      }
+
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
+  /*
+   * Resamples all the images of the batch
+   */
+  void ExecuteBatch()
+  {
+    vector<string> inputs = GetBatchInputs();
+    vector<BatchJobType> jobs;
+    map<string, string> inputOfOutput;
+    for (unsigned int i = 0; i < inputs.size(); i++)
+      {
+      BatchJobType job;
+      job.inFileName = inputs[i];
+      job.outFileName = GetBatchOutput(inputs[i]);
+      job.redundantRequestedBytes = 0;
+
+      // Two jobs must not write the same file
+      const string inPath = itksys::SystemTools::CollapseFullPath(job.inFileName);
+      const string outPath = itksys::SystemTools::CollapseFullPath(job.outFileName);
+      map<string, string>::const_iterator it = inputOfOutput.find(outPath);
+      if (it != inputOfOutput.end())
+        {
+        if (it->second == inPath)
+          {
+          otbAppLogWARNING("Skipping duplicate input " << job.inFileName);
+          continue;
+          }
+        otbAppLogFATAL("Inputs " << it->second << " and " << inPath << " have the same output "
+            << job.outFileName << ". Rename one of them, or process them in separate batches.");
+        }
+      inputOfOutput[outPath] = inPath;
+      jobs.push_back(job);
+      }
+
+    // Share the threads and the RAM between the concurrent images
+    unsigned int nbOfConcurrentImages = GetParameterInt("batch.nbconcurrent");
+    nbOfConcurrentImages = std::max(1u, std::min(nbOfConcurrentImages, static_cast<unsigned int>(jobs.size())));
+    const unsigned int nbOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+
+    BatchThreadStruct str;
+    str.Jobs = &jobs;
+    str.StepX = GetParameterInt("stepx");
+    str.StepY = GetParameterInt("stepy");
+    str.PixelType = GetParameterString("batch.pixtype");
+    str.NumberOfThreadsPerImage = std::max(1u, nbOfThreads / nbOfConcurrentImages);
+    str.RAMPerImage = std::max(1u, static_cast<unsigned int>(GetParameterInt("ram")) / nbOfConcurrentImages);
+
+    otbAppLogINFO("Processing " << jobs.size() << " images, " << nbOfConcurrentImages
+        << " at once with " << str.NumberOfThreadsPerImage << " threads each");
+
+    // Readers are created on the batch threads
+    ImageInformationMutex::InitializeFactories();
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads(nbOfConcurrentImages);
+    threader->SetSingleMethod(BatchThreaderCallback, &str);
+    threader->SingleMethodExecute();
+
+    // Report
+    unsigned int nbOfFailures = 0;
+    for (unsigned int i = 0; i < jobs.size(); i++)
+      {
+      if (jobs[i].error.empty())
+        {
+        otbAppLogINFO("Written " << jobs[i].outFileName << " (redundant requested input bytes: "
+            << jobs[i].redundantRequestedBytes << ")");
+        }
+      else
+        {
+        nbOfFailures++;
+        otbAppLogWARNING("Failed to process " << jobs[i].inFileName << ": " << jobs[i].error);
+        }
+      }
+    otbAppLogINFO(<< (jobs.size() - nbOfFailures) << " images processed, " << nbOfFailures << " failed");
+    if (nbOfFailures > 0)
+      {
+      otbAppLogFATAL(<< nbOfFailures << " of " << jobs.size() << " images failed");
+      }
+  }
+
   void DoExecute()
   {
 
+    if (HasValue("batch.il") || HasValue("batch.dir"))
+      {
+      ExecuteBatch();
+      return;
+      }
+
+    if (!HasValue("in") || !HasValue("out"))
+      {
+      otbAppLogFATAL("Parameters in and out are required, unless batch.il or batch.dir is set");
+      }
+
     FloatVectorImageType* xs = GetParameterImage("in");
 
     m_ExtractFilter = ExtractFilterType::New();
@@ -0,0 +1,546 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "itkFixedArray.h"
+#include "itkObjectFactory.h"
+
+// Elevation handler
+#include "otbWrapperElevationParametersHandler.h"
+#include "otbWrapperApplicationFactory.h"
+
+// Application engine
+#include "otbStandardFilterWatcher.h"
+
+// Image
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "otbImageFileWriter.h"
+
+// Regions
+#include "otbRegionComparator.h"
+#include "otbSpatialReferenceCache.h"
+
+// Vector data
+#include "gdal.h"
+#include "ogr_api.h"
+#include "ogr_srs_api.h"
+#include "cpl_conv.h"
+
+#include <map>
+#include <set>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace otb
+{
+
+namespace Wrapper
+{
+
+class PatchesExtraction : public Application
+{
+public:
+  /** Standard class typedefs. */
+  typedef PatchesExtraction             Self;
+  typedef Application                   Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Standard macro */
+  itkNewMacro(Self);
+  itkTypeMacro(PatchesExtraction, Application);
+
+  /** Typedefs for images and regions */
+  typedef FloatVectorImageType::RegionType                    RegionType;
+  typedef FloatVectorImageType::IndexType                     IndexType;
+  typedef FloatVectorImageType::SizeType                      SizeType;
+  typedef otb::RegionComparator<FloatVectorImageType>         RegionComparatorType;
+  typedef RegionComparatorType::RSRegion                      RSRegionType;
+  typedef itk::ImageRegionConstIterator<FloatVectorImageType> InputIteratorType;
+  typedef itk::ImageRegionIterator<FloatVectorImageType>      OutputIteratorType;
+  typedef otb::ImageFileWriter<FloatVectorImageType>          WriterType;
+
+  /** A patch to extract */
+  struct PatchType
+  {
+    RegionType     region;   // Region in the input image
+    string         label;    // Class of the patch
+    unsigned long  block;    // Input block containing the patch center
+    unsigned long  hilbert;  // Position of the block along the Hilbert curve
+    unsigned int   position; // Position of the patch in the output
+  };
+
+  /** Sort patches along the Hilbert curve, then by block */
+  static bool PatchCompare(const PatchType & a, const PatchType & b)
+  {
+    if (a.hilbert != b.hilbert)
+      return a.hilbert < b.hilbert;
+    return a.position < b.position;
+  }
+
+  /** Position of (x, y) along the Hilbert curve filling a n x n grid (n is a power of 2) */
+  static unsigned long HilbertIndex(unsigned long n, unsigned long x, unsigned long y)
+  {
+    unsigned long d = 0;
+    for (unsigned long s = n / 2; s > 0; s /= 2)
+      {
+      const unsigned long rx = (x & s) > 0;
+      const unsigned long ry = (y & s) > 0;
+      d += s * s * ((3 * rx) ^ ry);
+      if (ry == 0)
+        {
+        if (rx == 1)
+          {
+          x = n - 1 - x;
+          y = n - 1 - y;
+          }
+        std::swap(x, y);
+        }
+      }
+    return d;
+  }
+
+  void DoInit()
+  {
+
+    SetName("PatchesExtraction");
+    SetDescription("Extract patches of an image around the geometries of a vector layer");
+
+    // Documentation
+    SetDocLongDescription("This application extracts many small patches from an input image, "
+        "centered on the geometries (points or polygons) of a vector layer. Patches are grouped "
+        "by the input block holding their center, and the groups are read in the order of the "
+        "input image blocks (along a Hilbert curve): each group reads the bounding box of its "
+        "patches, which may overlap the neighbouring blocks. Patches are written either stacked (in the features order) in one single image, or in one image "
+        "per class.");
+    SetDocLimitations("Patches which are not entirely inside the input image are skipped. "
+        "All patches are kept in memory before being written: the output needs "
+        "sizex * sizey * (number of bands) * 4 bytes per patch, whatever the available RAM.");
+    SetDocAuthors("Remi Cresson");
+    SetDocSeeAlso(" ");
+
+    AddDocTag(Tags::Manip);
+
+    AddParameter(ParameterType_InputImage,   "in",  "Input Image");
+    SetParameterDescription("in"," Input image.");
+
+    AddParameter(ParameterType_InputFilename, "vec", "Input vector data");
+    SetParameterDescription("vec", "Points or polygons. Patches are centered on the geometries.");
+
+    AddParameter(ParameterType_String, "field", "Class field");
+    SetParameterDescription("field", "Field of the vector data used as patch class. "
+        "Mandatory with the perclass output mode.");
+    MandatoryOff("field");
+
+    AddParameter(ParameterType_Int, "sizex", "Patch size x" );
+    SetMinimumParameterIntValue("sizex", 1);
+    SetDefaultParameterInt("sizex", 64);
+    AddParameter(ParameterType_Int, "sizey", "Patch size y" );
+    SetMinimumParameterIntValue("sizey", 1);
+    SetDefaultParameterInt("sizey", 64);
+
+    AddParameter(ParameterType_Int, "blocksize", "Input block size" );
+    SetParameterDescription("blocksize", "Size of the input blocks used to group the patches. "
+        "0 means the input file tiling (or 256 if unknown).");
+    SetMinimumParameterIntValue("blocksize", 0);
+    SetDefaultParameterInt("blocksize", 0);
+    MandatoryOff("blocksize");
+
+    AddParameter(ParameterType_Choice, "outmode", "Output mode");
+    AddChoice("outmode.stack", "Patches stacked in one image");
+    AddParameter(ParameterType_OutputImage, "outmode.stack.out", "Output patches image");
+    SetParameterDescription("outmode.stack.out", "Patches stacked along rows, in the features order.");
+    AddParameter(ParameterType_OutputFilename, "outmode.stack.labels", "Output patches classes");
+    SetParameterDescription("outmode.stack.labels", "Text file with the class of each patch, one per line.");
+    MandatoryOff("outmode.stack.labels");
+    AddChoice("outmode.perclass", "One image per class");
+    AddParameter(ParameterType_String, "outmode.perclass.prefix", "Output prefix");
+    SetParameterDescription("outmode.perclass.prefix", "Patches of class C are written in <prefix>_C.tif "
+        "(characters of C other than letters, digits, '-', '_' and '.' are replaced by '_')");
+
+    // Doc example parameter settings
+    SetDocExampleParameterValue("in", "QB_Toulouse_Ortho_XS.tif");
+    SetDocExampleParameterValue("vec", "points.shp");
+    SetDocExampleParameterValue("field", "class");
+    SetDocExampleParameterValue("sizex", "32");
+    SetDocExampleParameterValue("sizey", "32");
+    SetDocExampleParameterValue("outmode.stack.out", "patches.tif");
+
+  }
+
+  void DoUpdateParameters()
+  {
+    // The class field is needed to split patches per class
+    if (GetParameterString("outmode") == "perclass")
+      {
+      MandatoryOn("field");
+      }
+    else
+      {
+      MandatoryOff("field");
+      }
+  }
+
+  /*
+   * Returns a label usable in a file name
+   */
+  static string SanitizeLabel(const string & label)
+  {
+    string sanitized(label);
+    for (unsigned int i = 0; i < sanitized.size(); i++)
+      {
+      const char c = sanitized[i];
+      if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.')
+        sanitized[i] = '_';
+      }
+    if (sanitized.empty())
+      sanitized = "_";
+    return sanitized;
+  }
+
+  /*
+   * Reads the geometries of the vector layer, and computes the patches regions
+   */
+  void ComputePatches(FloatVectorImageType * image, vector<PatchType> & patches)
+  {
+    const string vecFileName = GetParameterString("vec");
+    const bool useField = HasValue("field");
+    const string field = useField ? GetParameterString("field") : "";
+
+    GDALAllRegister();
+    GDALDatasetH ds = GDALOpenEx(vecFileName.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL);
+    if (ds == NULL || GDALDatasetGetLayerCount(ds) == 0)
+      {
+      otbAppLogFATAL("Unable to read vector data " << vecFileName);
+      }
+    OGRLayerH layer = GDALDatasetGetLayer(ds, 0);
+
+    // Class field
+    int fieldIndex = -1;
+    if (useField)
+      {
+      fieldIndex = OGR_FD_GetFieldIndex(OGR_L_GetLayerDefn(layer), field.c_str());
+      if (fieldIndex < 0)
+        {
+        GDALClose(ds);
+        otbAppLogFATAL("Field " << field << " not found in vector data " << vecFileName);
+        }
+      }
+
+    // Vector data SRS
+    string vecWkt;
+    OGRSpatialReferenceH srs = OGR_L_GetSpatialRef(layer);
+    if (srs != NULL)
+      {
+      char * wkt = NULL;
+      OSRExportToWkt(srs, &wkt);
+      vecWkt = wkt;
+      CPLFree(wkt);
+      }
+    const string imageWkt = RegionComparatorType::GetProjectionRef(image);
+    const bool reproject = !vecWkt.empty() && !imageWkt.empty() &&
+        SpatialReferenceCache::GetSRSId(vecWkt) != SpatialReferenceCache::GetSRSId(imageWkt);
+
+    RegionComparatorType comparator;
+    comparator.SetImage1(image);
+
+    const RegionType largestRegion = image->GetLargestPossibleRegion();
+    SizeType patchSize;
+    patchSize[0] = GetParameterInt("sizex");
+    patchSize[1] = GetParameterInt("sizey");
+
+    unsigned int nbOfSkipped = 0;
+    OGRFeatureH feature;
+    OGR_L_ResetReading(layer);
+    while ( (feature = OGR_L_GetNextFeature(layer)) != NULL )
+      {
+      OGRGeometryH geom = OGR_F_GetGeometryRef(feature);
+      if (geom == NULL)
+        {
+        OGR_F_Destroy(feature);
+        continue;
+        }
+
+      // Geometry envelope, in the image SRS
+      OGREnvelope env;
+      OGR_G_GetEnvelope(geom, &env);
+      double x[2] = {env.MinX, env.MaxX};
+      double y[2] = {env.MinY, env.MaxY};
+      int success[2] = {1, 1};
+      if (reproject)
+        {
+        SpatialReferenceCache::Transform(vecWkt, imageWkt, 2, x, y, success);
+        }
+      if (!success[0] || !success[1])
+        {
+        nbOfSkipped++;
+        OGR_F_Destroy(feature);
+        continue;
+        }
+
+      // Envelope --> image region
+      itk::ContinuousIndex<double> origin, size;
+      origin[0] = std::min(x[0], x[1]);
+      origin[1] = std::min(y[0], y[1]);
+      size[0] = std::abs(x[1] - x[0]);
+      size[1] = std::abs(y[1] - y[0]);
+      RSRegionType rsRegion;
+      rsRegion.SetOrigin(origin);
+      rsRegion.SetSize(size);
+      RegionType geomRegion = comparator.RSRegionToImageRegion(rsRegion);
+
+      // Patch centered on the geometry region
+      PatchType patch;
+      IndexType start;
+      for (unsigned int dim = 0; dim < 2; ++dim)
+        {
+        const long center = geomRegion.GetIndex()[dim] + static_cast<long>(geomRegion.GetSize()[dim] / 2);
+        start[dim] = center - static_cast<long>(patchSize[dim] / 2);
+        }
+      patch.region = RegionType(start, patchSize);
+      if (!largestRegion.IsInside(patch.region))
+        {
+        nbOfSkipped++;
+        OGR_F_Destroy(feature);
+        continue;
+        }
+
+      if (useField)
+        {
+        patch.label = OGR_F_GetFieldAsString(feature, fieldIndex);
+        }
+      patch.position = patches.size();
+      patches.push_back(patch);
+
+      OGR_F_Destroy(feature);
+      }
+    GDALClose(ds);
+
+    if (nbOfSkipped > 0)
+      {
+      otbAppLogWARNING(<< nbOfSkipped << " geometries skipped (patch outside the image)");
+      }
+  }
+
+  /*
+   * Sorts the patches along the Hilbert curve of the input blocks, and groups
+   * the patches by input block
+   */
+  void SortPatches(FloatVectorImageType * image, vector<PatchType> & patches,
+      vector<unsigned int> & groupsStart)
+  {
+    // Input blocks size
+    SizeType blockSize;
+    blockSize.Fill(GetParameterInt("blocksize"));
+    if (GetParameterInt("blocksize") == 0)
+      {
+      blockSize.Fill(256);
+      const itk::MetaDataDictionary & dict = image->GetMetaDataDictionary();
+      unsigned int tileHintX = 0, tileHintY = 0;
+      if (itk::ExposeMetaData<unsigned int>(dict, MetaDataKey::TileHintX, tileHintX) &&
+          itk::ExposeMetaData<unsigned int>(dict, MetaDataKey::TileHintY, tileHintY) &&
+          tileHintX > 0 && tileHintY > 0)
+        {
+        blockSize[0] = tileHintX;
+        blockSize[1] = tileHintY;
+        }
+      }
+    otbAppLogINFO("Input block size: " << blockSize);
+
+    // Blocks grid
+    const RegionType largestRegion = image->GetLargestPossibleRegion();
+    const unsigned long nbBlocksX = (largestRegion.GetSize()[0] + blockSize[0] - 1) / blockSize[0];
+    const unsigned long nbBlocksY = (largestRegion.GetSize()[1] + blockSize[1] - 1) / blockSize[1];
+    unsigned long n = 1;
+    while (n < std::max(nbBlocksX, nbBlocksY))
+      n *= 2;
+
+    for (unsigned int i = 0; i < patches.size(); i++)
+      {
+      const RegionType & region = patches[i].region;
+      const unsigned long bx = static_cast<unsigned long>(region.GetIndex()[0] - largestRegion.GetIndex()[0]
+          + static_cast<long>(region.GetSize()[0] / 2)) / blockSize[0];
+      const unsigned long by = static_cast<unsigned long>(region.GetIndex()[1] - largestRegion.GetIndex()[1]
+          + static_cast<long>(region.GetSize()[1] / 2)) / blockSize[1];
+      patches[i].block = by * nbBlocksX + bx;
+      patches[i].hilbert = HilbertIndex(n, bx, by);
+      }
+    std::sort(patches.begin(), patches.end(), PatchCompare);
+
+    // Groups of patches sharing the same block
+    groupsStart.clear();
+    for (unsigned int i = 0; i < patches.size(); i++)
+      {
+      if (i == 0 || patches[i].block != patches[i-1].block)
+        groupsStart.push_back(i);
+      }
+    groupsStart.push_back(patches.size());
+  }
+
+  /*
+   * Allocates an image of nbOfPatches stacked patches
+   */
+  FloatVectorImageType::Pointer CreateStack(FloatVectorImageType * image, unsigned int nbOfPatches)
+  {
+    SizeType size;
+    size[0] = GetParameterInt("sizex");
+    size[1] = GetParameterInt("sizey") * nbOfPatches;
+    RegionType region;
+    region.SetSize(size);
+
+    FloatVectorImageType::Pointer stack = FloatVectorImageType::New();
+    stack->SetRegions(region);
+    stack->SetNumberOfComponentsPerPixel(image->GetNumberOfComponentsPerPixel());
+    stack->Allocate();
+    return stack;
+  }
+
+  void DoExecute()
+  {
+
+    FloatVectorImageType* image = GetParameterImage("in");
+    image->UpdateOutputInformation();
+
+    // Patches regions, in I/O order
+    vector<PatchType> patches;
+    ComputePatches(image, patches);
+    if (patches.size() == 0)
+      {
+      otbAppLogFATAL("No patch to extract");
+      }
+    vector<unsigned int> groupsStart;
+    SortPatches(image, patches, groupsStart);
+    otbAppLogINFO("Extracting " << patches.size() << " patches from "
+        << (groupsStart.size() - 1) << " input blocks");
+
+    // Output images, and position of each patch in its output image
+    const bool perClass = (GetParameterString("outmode") == "perclass");
+    if (perClass && !HasValue("field"))
+      {
+      otbAppLogFATAL("A class field is needed with the perclass output mode");
+      }
+    otbAppLogINFO("Memory needed for the patches: " << (patches.size() * GetParameterInt("sizex")
+        * GetParameterInt("sizey") * image->GetNumberOfComponentsPerPixel() * sizeof(float) / (1024 * 1024))
+        << " MB");
+    map<string, unsigned int> nbOfPatchesPerClass;
+    vector<unsigned int> slots(patches.size());
+    for (unsigned int i = 0; i < patches.size(); i++)
+      {
+      const string key = perClass ? patches[i].label : "";
+      slots[i] = nbOfPatchesPerClass[key]++;
+      }
+    if (!perClass)
+      {
+      // Stacked in the features order
+      for (unsigned int i = 0; i < patches.size(); i++)
+        slots[i] = patches[i].position;
+      }
+    map<string, FloatVectorImageType::Pointer> stacks;
+    for (map<string, unsigned int>::iterator it = nbOfPatchesPerClass.begin(); it != nbOfPatchesPerClass.end(); ++it)
+      {
+      stacks[it->first] = CreateStack(image, it->second);
+      }
+
+    // Read each group of patches at once
+    for (unsigned int g = 0; g + 1 < groupsStart.size(); g++)
+      {
+      RegionType groupRegion = patches[groupsStart[g]].region;
+      for (unsigned int i = groupsStart[g] + 1; i < groupsStart[g+1]; i++)
+        {
+        const RegionType & region = patches[i].region;
+        IndexType start, end;
+        for (unsigned int dim = 0; dim < 2; ++dim)
+          {
+          start[dim] = std::min(groupRegion.GetIndex()[dim], region.GetIndex()[dim]);
+          end[dim] = std::max(groupRegion.GetUpperIndex()[dim], region.GetUpperIndex()[dim]);
+          }
+        groupRegion.SetIndex(start);
+        groupRegion.SetUpperIndex(end);
+        }
+
+      image->SetRequestedRegion(groupRegion);
+      image->PropagateRequestedRegion();
+      image->UpdateOutputData();
+
+      // Copy patches
+      for (unsigned int i = groupsStart[g]; i < groupsStart[g+1]; i++)
+        {
+        FloatVectorImageType::Pointer stack = stacks[perClass ? patches[i].label : ""];
+        RegionType outRegion = patches[i].region;
+        IndexType outStart;
+        outStart[0] = 0;
+        outStart[1] = slots[i] * outRegion.GetSize()[1];
+        outRegion.SetIndex(outStart);
+
+        InputIteratorType inIt(image, patches[i].region);
+        OutputIteratorType outIt(stack, outRegion);
+        for (inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++outIt, ++inIt)
+          {
+          outIt.Set(inIt.Get());
+          }
+        }
+      }
+
+    // Write outputs
+    if (perClass)
+      {
+      std::set<string> names;
+      for (map<string, FloatVectorImageType::Pointer>::iterator it = stacks.begin(); it != stacks.end(); ++it)
+        {
+        // Different labels may give the same sanitized name
+        string name = SanitizeLabel(it->first);
+        for (unsigned int n = 1; names.count(name) > 0; n++)
+          {
+          std::ostringstream suffixed;
+          suffixed << SanitizeLabel(it->first) << "_" << n;
+          name = suffixed.str();
+          }
+        names.insert(name);
+
+        std::ostringstream filename;
+        filename << GetParameterString("outmode.perclass.prefix") << "_" << name << ".tif";
+        otbAppLogINFO("Writing " << filename.str());
+        WriterType::Pointer writer = WriterType::New();
+        writer->SetFileName(filename.str());
+        writer->SetInput(it->second);
+        writer->Update();
+        }
+      }
+    else
+      {
+      m_Stack = stacks[""];
+      SetParameterOutputImage("outmode.stack.out", m_Stack);
+
+      if (HasValue("outmode.stack.labels"))
+        {
+        vector<string> labels(patches.size());
+        for (unsigned int i = 0; i < patches.size(); i++)
+          labels[patches[i].position] = patches[i].label;
+
+        std::ofstream labelsFile(GetParameterString("outmode.stack.labels").c_str());
+        for (unsigned int i = 0; i < labels.size(); i++)
+          labelsFile << labels[i] << std::endl;
+        }
+      }
+
+  }
+
+  FloatVectorImageType::Pointer m_Stack;
+
+};
+}
+}
+
+OTB_APPLICATION_EXPORT( otb::Wrapper::PatchesExtraction )
@@ -0,0 +1,1088 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+/*
+ * Benchmark of the SimpleExtractionTools filters.
+ *
+ * Synthetic inputs are generated (once) in the data directory, from a fixed
+ * seed, so that runs are reproducible without any download:
+ *  - a float raster and a uint16 raster (tiled GeoTIFF),
+ *  - a blocky label map,
+ *  - a layer of random polygons,
+ *  - a directory of overlapping GeoTIFF tiles.
+ *
+ * Each filter is run for each number of threads, and the median wall time,
+ * throughput (pixels/s, features/s), speedup, peak buffer size and peak
+ * resident memory of the case are written as one JSON object per line. Results can be
+ * compared against a baseline file produced by a previous run: the program
+ * returns a non-zero code if a case is slower than the baseline by more than
+ * the tolerance.
+ *
+ * With --check, behaviour checks of the module classes are run instead, on
+ * small inputs with known results, and the program returns a non-zero code if
+ * any check fails.
+ */
+
+#include "itkMultiThreader.h"
+#include "itkImageRegionIterator.h"
+#include "itkMetaDataObject.h"
+#include "itkMath.h"
+
+#include "otbImage.h"
+#include "otbVectorImage.h"
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "otbStreamingImageVirtualWriter.h"
+#include "otbMetaDataKey.h"
+#include "otbVectorData.h"
+#include "otbDataNode.h"
+
+#include "otbMeanResampleImageFilter.h"
+#include "otbCacheLessLabelImageToVectorData.h"
+#include "otbVectorDataToLabelImageCustomFilter.h"
+#include "otbMosaicFromDirectoryHandler.h"
+#include "otbPerformanceRecorder.h"
+#include "otbDatasetHandlePool.h"
+#include "otbPooledImageFileReader.h"
+#include "otbStreamingCompositingMosaicFilter.h"
+#include "otbRegionCatalogComparator.h"
+#include "otbSpatialReferenceCache.h"
+
+#include "gdal.h"
+#include "ogr_api.h"
+#include "ogr_spatialref.h"
+#include "cpl_conv.h"
+
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef otb::Image<float>                           FloatImageType;
+typedef otb::Image<unsigned short>                  UInt16ImageType;
+typedef otb::Image<unsigned int>                    LabelImageType;
+typedef otb::Image<unsigned char>                   TileImageType;
+typedef otb::VectorData<double>                     VectorDataType;
+typedef VectorDataType::DataNodeType                DataNodeType;
+typedef DataNodeType::PolygonType                   PolygonType;
+
+/** Command line parameters */
+struct ParametersType
+{
+  std::string               DataDirectory;
+  std::string               Output;
+  std::string               Baseline;
+  unsigned int              Size;
+  unsigned int              NumberOfPolygons;
+  unsigned int              Repeats;
+  unsigned int              RAM;
+  unsigned int              Seed;
+  double                    Tolerance;
+  std::vector<unsigned int> Threads;
+  bool                      Check;
+};
+
+/** What a run of a case has processed */
+struct RunType
+{
+  RunType() : Pixels(0), Features(0), PeakBufferBytes(0) {}
+  unsigned long Pixels;
+  unsigned long Features;
+  unsigned long PeakBufferBytes;
+};
+
+/** Result of a case, for one number of threads */
+struct ResultType
+{
+  std::string   Case;
+  unsigned int  Threads;
+  double        Seconds;
+  double        Speedup;
+  RunType       Run;
+  long          PeakRSSKiB;
+};
+
+/** Geometry of the synthetic rasters */
+const double OriginX = 500000.0;
+const double OriginY = 4800000.0;
+const double Spacing = 10.0;
+
+std::string GetProjectionRef()
+{
+  OGRSpatialReference srs;
+  srs.importFromEPSG(32631);
+  char * wkt = NULL;
+  srs.exportToWkt(&wkt);
+  std::string projectionRef(wkt);
+  CPLFree(wkt);
+  return projectionRef;
+}
+
+template <class TImage>
+typename TImage::Pointer CreateImage(unsigned int sizeX, unsigned int sizeY, double originX, double originY)
+{
+  typename TImage::RegionType region;
+  region.SetSize(0, sizeX);
+  region.SetSize(1, sizeY);
+
+  typename TImage::SpacingType spacing;
+  spacing[0] = Spacing;
+  spacing[1] = -Spacing;
+
+  typename TImage::PointType origin;
+  origin[0] = originX;
+  origin[1] = originY;
+
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(region);
+  image->SetSignedSpacing(spacing);
+  image->SetOrigin(origin);
+  image->Allocate();
+  itk::EncapsulateMetaData<std::string>(image->GetMetaDataDictionary(),
+      otb::MetaDataKey::ProjectionRefKey, GetProjectionRef());
+  return image;
+}
+
+template <class TImage>
+void WriteTiledImage(TImage * image, const std::string & filename)
+{
+  typedef otb::ImageFileWriter<TImage> WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(filename + "?&gdal:co:TILED=YES&gdal:co:BLOCKXSIZE=256&gdal:co:BLOCKYSIZE=256");
+  writer->SetInput(image);
+  writer->Update();
+}
+
+/** Smooth field with noise */
+void GenerateFloatImage(const std::string & filename, const ParametersType & params)
+{
+  std::mt19937 rng(params.Seed);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  FloatImageType::Pointer image = CreateImage<FloatImageType>(params.Size, params.Size, OriginX, OriginY);
+  itk::ImageRegionIterator<FloatImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    const FloatImageType::IndexType idx = it.GetIndex();
+    it.Set(std::sin(0.01f * idx[0]) * std::cos(0.013f * idx[1]) + noise(rng));
+    }
+  WriteTiledImage<FloatImageType>(image, filename);
+}
+
+/** Uniform noise, in the range of 12 bits sensors */
+void GenerateUInt16Image(const std::string & filename, const ParametersType & params)
+{
+  std::mt19937 rng(params.Seed + 1);
+  std::uniform_int_distribution<unsigned int> value(0, 4095);
+  UInt16ImageType::Pointer image = CreateImage<UInt16ImageType>(params.Size, params.Size, OriginX, OriginY);
+  itk::ImageRegionIterator<UInt16ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    it.Set(static_cast<unsigned short>(value(rng)));
+    }
+  WriteTiledImage<UInt16ImageType>(image, filename);
+}
+
+/** Blocks of 64x64 pixels, with random labels in [1, 50] */
+void GenerateLabelImage(const std::string & filename, const ParametersType & params)
+{
+  const unsigned int blockSize = 64;
+  const unsigned int nbBlocks = (params.Size + blockSize - 1) / blockSize;
+  std::mt19937 rng(params.Seed + 2);
+  std::uniform_int_distribution<unsigned int> label(1, 50);
+  std::vector<unsigned int> labels(nbBlocks * nbBlocks);
+  for (unsigned int i = 0; i < labels.size(); i++)
+    {
+    labels[i] = label(rng);
+    }
+
+  LabelImageType::Pointer image = CreateImage<LabelImageType>(params.Size, params.Size, OriginX, OriginY);
+  itk::ImageRegionIterator<LabelImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    const LabelImageType::IndexType idx = it.GetIndex();
+    it.Set(labels[(idx[1] / blockSize) * nbBlocks + idx[0] / blockSize]);
+    }
+  WriteTiledImage<LabelImageType>(image, filename);
+}
+
+/** 4x4 overlapping tiles of uint8 values covering the whole extent */
+void GenerateTiles(const std::string & directory, const ParametersType & params)
+{
+  const unsigned int nbTiles = 4;
+  const unsigned int overlap = params.Size / 20;
+  const unsigned int tileSize = (params.Size + (nbTiles - 1) * overlap) / nbTiles;
+  std::mt19937 rng(params.Seed + 3);
+  std::uniform_int_distribution<unsigned int> value(1, 255);
+
+  itksys::SystemTools::MakeDirectory(directory.c_str());
+  for (unsigned int row = 0; row < nbTiles; row++)
+    {
+    for (unsigned int col = 0; col < nbTiles; col++)
+      {
+      const double originX = OriginX + col * (tileSize - overlap) * Spacing;
+      const double originY = OriginY - row * (tileSize - overlap) * Spacing;
+      TileImageType::Pointer image = CreateImage<TileImageType>(tileSize, tileSize, originX, originY);
+      itk::ImageRegionIterator<TileImageType> it(image, image->GetLargestPossibleRegion());
+      for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+        {
+        it.Set(static_cast<unsigned char>(value(rng)));
+        }
+
+      std::ostringstream filename;
+      filename << directory << "/tile_" << row << "_" << col << ".tif";
+      WriteTiledImage<TileImageType>(image, filename.str());
+      }
+    }
+}
+
+/** Random star-shaped polygons with 3 to 8 vertices, with a "class" field */
+VectorDataType::Pointer GeneratePolygons(const ParametersType & params)
+{
+  std::mt19937 rng(params.Seed + 4);
+  const double extent = params.Size * Spacing;
+  std::uniform_real_distribution<double> centerX(OriginX, OriginX + extent);
+  std::uniform_real_distribution<double> centerY(OriginY - extent, OriginY);
+  std::uniform_real_distribution<double> radius(5 * Spacing, 50 * Spacing);
+  std::uniform_real_distribution<double> angle(0.0, 2.0 * itk::Math::pi);
+  std::uniform_int_distribution<unsigned int> nbVertices(3, 8);
+  std::uniform_int_distribution<int> label(1, 50);
+
+  VectorDataType::Pointer vectorData = VectorDataType::New();
+  vectorData->SetProjectionRef(GetProjectionRef());
+  DataNodeType::Pointer root = vectorData->GetDataTree()->GetRoot()->Get();
+  DataNodeType::Pointer document = DataNodeType::New();
+  document->SetNodeType(otb::DOCUMENT);
+  DataNodeType::Pointer folder = DataNodeType::New();
+  folder->SetNodeType(otb::FOLDER);
+  vectorData->GetDataTree()->Add(document, root);
+  vectorData->GetDataTree()->Add(folder, document);
+
+  for (unsigned int i = 0; i < params.NumberOfPolygons; i++)
+    {
+    const double cx = centerX(rng);
+    const double cy = centerY(rng);
+    std::vector<double> angles(nbVertices(rng));
+    for (unsigned int j = 0; j < angles.size(); j++)
+      {
+      angles[j] = angle(rng);
+      }
+    std::sort(angles.begin(), angles.end());
+
+    PolygonType::Pointer ring = PolygonType::New();
+    for (unsigned int j = 0; j < angles.size(); j++)
+      {
+      const double r = radius(rng);
+      PolygonType::VertexType vertex;
+      vertex[0] = cx + r * std::cos(angles[j]);
+      vertex[1] = cy + r * std::sin(angles[j]);
+      ring->AddVertex(vertex);
+      }
+
+    DataNodeType::Pointer polygon = DataNodeType::New();
+    polygon->SetNodeType(otb::FEATURE_POLYGON);
+    polygon->SetPolygonExteriorRing(ring);
+    polygon->SetFieldAsInt("class", label(rng));
+    vectorData->GetDataTree()->Add(polygon, folder);
+    }
+
+  return vectorData;
+}
+
+/** Resets the peak resident memory of the process to its current resident
+ * memory. Only supported on Linux: returns false elsewhere */
+bool ResetPeakRSS()
+{
+  std::ofstream os("/proc/self/clear_refs");
+  if (!os)
+    {
+    return false;
+    }
+  os << "5";
+  os.close();
+  return !os.fail();
+}
+
+/** Peak resident memory (KiB) since the last ResetPeakRSS(), -1 if unavailable */
+long GetPeakRSSKiB()
+{
+  std::ifstream is("/proc/self/status");
+  std::string line;
+  while (std::getline(is, line))
+    {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      {
+      return std::atol(line.c_str() + 6);
+      }
+    }
+  return -1;
+}
+
+/** Streams the output of a filter without writing it */
+template <class TImage>
+void Stream(TImage * image, unsigned int ram)
+{
+  typedef otb::StreamingImageVirtualWriter<TImage> VirtualWriterType;
+  typename VirtualWriterType::Pointer writer = VirtualWriterType::New();
+  writer->SetInput(image);
+  writer->SetAutomaticAdaptativeStreaming(ram);
+  writer->Update();
+}
+
+/*
+ * Cases
+ */
+
+template <class TImage>
+RunType RunMeanResample(const std::string & filename, const ParametersType & params)
+{
+  typedef otb::ImageFileReader<TImage>            ReaderType;
+  typedef otb::MeanResampleImageFilter<TImage>    FilterType;
+
+  otb::PerformanceRecorder::Pointer recorder = otb::PerformanceRecorder::New();
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(filename);
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(reader->GetOutput());
+  filter->SetStepX(4);
+  filter->SetStepY(4);
+  filter->SetPerformanceRecorder(recorder);
+  Stream<TImage>(filter->GetOutput(), params.RAM);
+
+  RunType run;
+  run.Pixels = reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  run.PeakBufferBytes = recorder->GetPeakBufferBytes("MeanResampleImageFilter");
+  return run;
+}
+
+RunType RunVectorize(const std::string & filename, const ParametersType & params)
+{
+  typedef otb::ImageFileReader<LabelImageType>                    ReaderType;
+  typedef otb::CacheLessLabelImageToVectorData<unsigned int>      FilterType;
+
+  otb::PerformanceRecorder::Pointer recorder = otb::PerformanceRecorder::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(filename);
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(reader->GetOutput());
+  filter->SetAutomaticAdaptativeStreaming(params.RAM);
+  filter->SetPerformanceRecorder(recorder);
+  filter->Update();
+
+  RunType run;
+  run.Pixels = reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  run.Features = FilterType::CountFeatures(filter->GetOutput());
+  run.PeakBufferBytes = recorder->GetPeakBufferBytes("CacheLessLabelImageToVectorData");
+  return run;
+}
+
+RunType RunRasterize(const VectorDataType * polygons, const ParametersType & params)
+{
+  typedef otb::VectorDataToLabelImageCustomFilter<VectorDataType, LabelImageType> FilterType;
+
+  FilterType::OutputOriginType origin;
+  origin[0] = OriginX;
+  origin[1] = OriginY;
+  FilterType::OutputSpacingType spacing;
+  spacing[0] = Spacing;
+  spacing[1] = -Spacing;
+  FilterType::OutputSizeType size;
+  size.Fill(params.Size);
+
+  otb::PerformanceRecorder::Pointer recorder = otb::PerformanceRecorder::New();
+  FilterType::Pointer filter = FilterType::New();
+  filter->AddVectorData(polygons);
+  filter->SetOutputOrigin(origin);
+  filter->SetOutputSpacing(spacing);
+  filter->SetOutputSize(size);
+  filter->SetOutputProjectionRef(polygons->GetProjectionRef());
+  filter->SetBurnAttribute("class");
+  filter->SetPerformanceRecorder(recorder);
+  Stream<LabelImageType>(filter->GetOutput(), params.RAM);
+
+  RunType run;
+  run.Pixels = filter->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  run.Features = params.NumberOfPolygons;
+  run.PeakBufferBytes = recorder->GetPeakBufferBytes("VectorDataToLabelImageCustomFilter");
+  return run;
+}
+
+RunType RunMosaic(const std::string & directory, const ParametersType & params)
+{
+  typedef otb::MosaicFromDirectoryHandler<TileImageType, TileImageType> FilterType;
+
+  FilterType::PointType origin;
+  origin[0] = OriginX;
+  origin[1] = OriginY;
+  FilterType::SpacingType spacing;
+  spacing[0] = Spacing;
+  spacing[1] = -Spacing;
+  FilterType::SizeType size;
+  size.Fill(params.Size);
+
+  otb::PerformanceRecorder::Pointer recorder = otb::PerformanceRecorder::New();
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetDirectory(directory);
+  filter->SetOutputOrigin(origin);
+  filter->SetOutputSpacing(spacing);
+  filter->SetOutputSize(size);
+  filter->SetPerformanceRecorder(recorder);
+  Stream<TileImageType>(filter->GetOutput(), params.RAM);
+
+  RunType run;
+  run.Pixels = filter->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  run.PeakBufferBytes = recorder->GetPeakBufferBytes("MosaicFromDirectoryHandler");
+  return run;
+}
+
+/*
+ * Measurement
+ */
+
+/** Runs a case params.Repeats times and keeps the median wall time */
+ResultType Measure(const std::string & name, unsigned int threads, const ParametersType & params,
+    const std::function<RunType()> & run)
+{
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads(threads);
+
+  ResultType result;
+  result.Case = name;
+  result.Threads = threads;
+  result.Speedup = 1.0;
+
+  // The peak resident memory can't be reset on all systems: report it only
+  // when it is the peak of this case, not of the whole process
+  const bool hasPeakRSS = ResetPeakRSS();
+
+  std::vector<double> seconds;
+  for (unsigned int i = 0; i < params.Repeats; i++)
+    {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    result.Run = run();
+    seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+  std::sort(seconds.begin(), seconds.end());
+  result.Seconds = seconds[seconds.size() / 2];
+  result.PeakRSSKiB = hasPeakRSS ? GetPeakRSSKiB() : -1;
+  return result;
+}
+
+std::string ToJSON(const ResultType & result, const ParametersType & params)
+{
+  std::ostringstream os;
+  os << "{\"case\": \"" << result.Case << "\", \"threads\": " << result.Threads
+     << ", \"size\": " << params.Size << ", \"repeats\": " << params.Repeats
+     << ", \"seconds\": " << result.Seconds << ", \"speedup\": " << result.Speedup
+     << ", \"pixels_per_s\": " << result.Run.Pixels / result.Seconds
+     << ", \"features_per_s\": " << result.Run.Features / result.Seconds
+     << ", \"peak_buffer_bytes\": " << result.Run.PeakBufferBytes
+     << ", \"peak_rss_kib\": " << result.PeakRSSKiB << "}";
+  return os.str();
+}
+
+/*
+ * Behaviour checks
+ */
+
+/** Reports a check. Returns 1 if it failed */
+unsigned int Check(bool condition, const std::string & what)
+{
+  std::cout << (condition ? "[ PASS       ] " : "[ FAIL       ] ") << what << std::endl;
+  return condition ? 0 : 1;
+}
+
+/** Least recently used eviction and counters of the dataset handle pool */
+unsigned int CheckDatasetHandlePool(const std::string & directory)
+{
+  typedef otb::DatasetHandlePool<TileImageType>       PoolType;
+  typedef otb::PooledImageFileReader<TileImageType>   PooledReaderType;
+
+  // Three small files filled with 10, 20, 30
+  PoolType::Pointer pool = PoolType::New();
+  pool->SetCapacity(2);
+  for (unsigned int i = 0; i < 3; i++)
+    {
+    TileImageType::Pointer image = CreateImage<TileImageType>(16, 16, OriginX, OriginY);
+    image->FillBuffer(static_cast<unsigned char>(10 * (i + 1)));
+    std::ostringstream filename;
+    filename << directory << "/pool_" << i << ".tif";
+    WriteTiledImage<TileImageType>(image, filename.str());
+    pool->AddFile(filename.str());
+    }
+
+  unsigned int nbOfFailures = 0;
+  pool->Acquire(0);
+  pool->Acquire(1);
+  pool->Acquire(0);
+  nbOfFailures += Check(pool->GetNumberOfMisses() == 2 && pool->GetNumberOfHits() == 1,
+      "DatasetHandlePool: 2 misses and 1 hit for handles 0, 1, 0");
+
+  // Opening the third file evicts the least recently used one (1)
+  pool->Acquire(2);
+  nbOfFailures += Check(pool->GetNumberOfOpenedFiles() == 2,
+      "DatasetHandlePool: the capacity bounds the number of opened files");
+  pool->Acquire(0);
+  nbOfFailures += Check(pool->GetNumberOfHits() == 2 && pool->GetNumberOfReopens() == 0,
+      "DatasetHandlePool: the most recently used file is kept open");
+  pool->Acquire(1);
+  nbOfFailures += Check(pool->GetNumberOfReopens() == 1,
+      "DatasetHandlePool: the least recently used file is reopened");
+
+  // Pooled readers read the right files, even with a single opened file
+  pool->SetCapacity(1);
+  bool valuesOk = true;
+  for (unsigned int i = 0; i < 3; i++)
+    {
+    PooledReaderType::Pointer reader = PooledReaderType::New();
+    reader->SetPool(pool);
+    reader->SetHandle(i);
+    reader->Update();
+    TileImageType::IndexType idx;
+    idx.Fill(8);
+    valuesOk = valuesOk && (reader->GetOutput()->GetPixel(idx) == 10 * (i + 1));
+    }
+  nbOfFailures += Check(valuesOk && pool->GetNumberOfOpenedFiles() <= 1,
+      "PooledImageFileReader: pixels read through a pool of capacity 1");
+
+  return nbOfFailures;
+}
+
+/** Output of the compositing of constant 4x4 single band images, with the
+ * priorities 3, 2, 1 */
+float Composite(int strategy, const std::vector<float> & values)
+{
+  typedef otb::VectorImage<float>                                     VectorImageType;
+  typedef otb::StreamingCompositingMosaicFilter<VectorImageType>     MosaicFilterType;
+
+  VectorImageType::RegionType region;
+  region.SetSize(0, 4);
+  region.SetSize(1, 4);
+  VectorImageType::SpacingType spacing;
+  spacing[0] = Spacing;
+  spacing[1] = -Spacing;
+  VectorImageType::PointType origin;
+  origin[0] = OriginX;
+  origin[1] = OriginY;
+
+  MosaicFilterType::Pointer mosaicFilter = MosaicFilterType::New();
+  for (unsigned int i = 0; i < values.size(); i++)
+    {
+    VectorImageType::Pointer image = VectorImageType::New();
+    image->SetRegions(region);
+    image->SetSignedSpacing(spacing);
+    image->SetOrigin(origin);
+    image->SetNumberOfComponentsPerPixel(1);
+    image->Allocate();
+    VectorImageType::PixelType pixel(1);
+    pixel[0] = values[i];
+    image->FillBuffer(pixel);
+    mosaicFilter->PushBackInput(image);
+    }
+
+  // No-data output value: -1
+  VectorImageType::PixelType noData(1);
+  noData[0] = -1;
+  mosaicFilter->SetOutputOrigin(origin);
+  mosaicFilter->SetOutputSpacing(spacing);
+  mosaicFilter->SetOutputSize(region.GetSize());
+  mosaicFilter->SetAutomaticOutputParametersComputation(false);
+  mosaicFilter->SetNoDataOutputPixel(noData);
+  mosaicFilter->SetCompositingStrategy(static_cast<MosaicFilterType::CompositingStrategyType>(strategy));
+  std::vector<double> priorities;
+  priorities.push_back(3);
+  priorities.push_back(2);
+  priorities.push_back(1);
+  mosaicFilter->SetInputPriorities(priorities);
+  mosaicFilter->Update();
+
+  VectorImageType::IndexType idx;
+  idx.Fill(2);
+  return mosaicFilter->GetOutput()->GetPixel(idx)[0];
+}
+
+/** Compositing strategies, on inputs with an empty (0) first image */
+unsigned int CheckCompositing()
+{
+  typedef otb::StreamingCompositingMosaicFilter<otb::VectorImage<float> > MosaicFilterType;
+
+  // Inputs: 0 (empty), 2, 6
+  std::vector<float> values, empty(3, 0.0f);
+  values.push_back(0);
+  values.push_back(2);
+  values.push_back(6);
+
+  unsigned int nbOfFailures = 0;
+  nbOfFailures += Check(Composite(MosaicFilterType::FIRST_VALID, values) == 2,
+      "StreamingCompositingMosaicFilter: FIRST_VALID skips the empty input");
+  nbOfFailures += Check(Composite(MosaicFilterType::LAST_VALID, values) == 6,
+      "StreamingCompositingMosaicFilter: LAST_VALID");
+  nbOfFailures += Check(Composite(MosaicFilterType::MAX, values) == 6,
+      "StreamingCompositingMosaicFilter: MAX");
+  nbOfFailures += Check(Composite(MosaicFilterType::MEAN, values) == 4,
+      "StreamingCompositingMosaicFilter: MEAN of the valid pixels only");
+  nbOfFailures += Check(Composite(MosaicFilterType::PRIORITY, values) == 2,
+      "StreamingCompositingMosaicFilter: PRIORITY skips the empty input of highest priority");
+
+  // No valid input: the no-data output value, whatever the strategy
+  bool noDataOk = true;
+  for (int strategy = MosaicFilterType::FIRST_VALID; strategy <= MosaicFilterType::PRIORITY; strategy++)
+    {
+    noDataOk = noDataOk && Composite(strategy, empty) == -1;
+    }
+  nbOfFailures += Check(noDataOk,
+      "StreamingCompositingMosaicFilter: no-data output value without valid input");
+
+  return nbOfFailures;
+}
+
+/** Overlaps of a catalog of 10x10 images, with their upper left pixel shifted
+ * by the given pixel offsets */
+std::vector<otb::RegionCatalogComparator<TileImageType>::OverlapType>
+ComputeCatalogOverlaps(const std::vector<std::pair<double, double> > & offsets)
+{
+  otb::RegionCatalogComparator<TileImageType> catalog;
+  for (unsigned int i = 0; i < offsets.size(); i++)
+    {
+    catalog.AddImage(CreateImage<TileImageType>(10, 10,
+        OriginX + offsets[i].first * Spacing, OriginY - offsets[i].second * Spacing));
+    }
+  return catalog.ComputeOverlaps();
+}
+
+/** Overlaps found by the sweep-line of the region catalog comparator */
+unsigned int CheckRegionCatalogComparator()
+{
+  typedef otb::RegionCatalogComparator<TileImageType>   CatalogType;
+  typedef std::pair<double, double>                     OffsetType;
+
+  unsigned int nbOfFailures = 0;
+
+  // 0 and 1 overlap over 5 columns, 2 shares (up to a roundoff error) the
+  // right edge of 0 and overlaps 1 over 5 columns, 3 is far away
+  std::vector<OffsetType> offsets;
+  offsets.push_back(OffsetType(0, 0));
+  offsets.push_back(OffsetType(5, 0));
+  offsets.push_back(OffsetType(10 - 1e-7, 0));
+  offsets.push_back(OffsetType(100, 100));
+  std::vector<CatalogType::OverlapType> overlaps = ComputeCatalogOverlaps(offsets);
+  bool overlapsOk = (overlaps.size() == 2);
+  for (unsigned int i = 0; overlapsOk && i < overlaps.size(); i++)
+    {
+    const CatalogType::OverlapType & overlap = overlaps[i];
+    overlapsOk = (overlap.Image2 == overlap.Image1 + 1) && (overlap.Image1 == 0 || overlap.Image1 == 1) &&
+        overlap.RegionInImage1.GetIndex()[0] == 5 && overlap.RegionInImage1.GetSize()[0] == 5 &&
+        overlap.RegionInImage2.GetIndex()[0] == 0 && overlap.RegionInImage2.GetSize()[0] == 5 &&
+        overlap.RegionInImage1.GetSize()[1] == 10 && overlap.RegionInImage2.GetSize()[1] == 10;
+    }
+  nbOfFailures += Check(overlapsOk,
+      "RegionCatalogComparator: overlaps of shifted images, none for images sharing an edge");
+
+  // Vertical strip: each image overlaps the next one over 2 rows
+  offsets.clear();
+  for (unsigned int i = 0; i < 20; i++)
+    {
+    offsets.push_back(OffsetType(0, 8 * i));
+    }
+  overlaps = ComputeCatalogOverlaps(offsets);
+  bool stripOk = (overlaps.size() == 19);
+  for (unsigned int i = 0; stripOk && i < overlaps.size(); i++)
+    {
+    stripOk = (overlaps[i].Image2 == overlaps[i].Image1 + 1) &&
+        overlaps[i].RegionInImage1.GetSize()[1] == 2 && overlaps[i].RegionInImage1.GetIndex()[1] == 8 &&
+        overlaps[i].RegionInImage2.GetSize()[1] == 2 && overlaps[i].RegionInImage2.GetIndex()[1] == 0;
+    }
+  nbOfFailures += Check(stripOk, "RegionCatalogComparator: overlaps of a vertical strip of images");
+
+  // Images of another SRS are rejected
+  CatalogType catalog;
+  catalog.AddImage(CreateImage<TileImageType>(10, 10, OriginX, OriginY));
+  TileImageType::Pointer geographic = CreateImage<TileImageType>(10, 10, OriginX, OriginY);
+  OGRSpatialReference srs;
+  srs.importFromEPSG(4326);
+  char * wkt = NULL;
+  srs.exportToWkt(&wkt);
+  itk::EncapsulateMetaData<std::string>(geographic->GetMetaDataDictionary(),
+      otb::MetaDataKey::ProjectionRefKey, std::string(wkt));
+  CPLFree(wkt);
+  bool rejected = false;
+  try
+    {
+    catalog.AddImage(geographic);
+    }
+  catch (itk::ExceptionObject &)
+    {
+    rejected = true;
+    }
+  nbOfFailures += Check(rejected && catalog.GetNumberOfImages() == 1,
+      "RegionCatalogComparator: images of another SRS are rejected");
+
+  return nbOfFailures;
+}
+
+/** Points transformed concurrently by the SRS cache */
+struct TransformThreadStruct
+{
+  std::string                         SourceWkt;
+  std::string                         TargetWkt;
+  std::vector<std::vector<double> > * X;
+  std::vector<std::vector<double> > * Y;
+};
+
+ITK_THREAD_RETURN_TYPE TransformThreaderCallback(void * arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  TransformThreadStruct * str = static_cast<TransformThreadStruct *>(info->UserData);
+  std::vector<double> & x = (*str->X)[info->ThreadID];
+  std::vector<double> & y = (*str->Y)[info->ThreadID];
+  std::vector<int> success(x.size());
+  for (unsigned int i = 0; i < 100; i++)
+    {
+    otb::SpatialReferenceCache::Transform(str->SourceWkt, str->TargetWkt, x.size(), &x[0], &y[0], &success[0]);
+    otb::SpatialReferenceCache::Transform(str->TargetWkt, str->SourceWkt, x.size(), &x[0], &y[0], &success[0]);
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/** SRS ids and cached transformations */
+unsigned int CheckSpatialReferenceCache()
+{
+  typedef otb::SpatialReferenceCache CacheType;
+
+  OGRSpatialReference srs;
+  srs.importFromEPSG(4326);
+  char * wkt = NULL;
+  srs.exportToWkt(&wkt);
+  const std::string geographicWkt(wkt);
+  CPLFree(wkt);
+  const std::string utmWkt = GetProjectionRef();
+
+  unsigned int nbOfFailures = 0;
+  nbOfFailures += Check(CacheType::GetSRSId(utmWkt) != 0 && CacheType::GetSRSId(utmWkt) == CacheType::GetSRSId("EPSG:32631"),
+      "SpatialReferenceCache: same id for the same SRS written differently");
+  nbOfFailures += Check(CacheType::GetSRSId(utmWkt) != CacheType::GetSRSId(geographicWkt) && CacheType::GetSRSId("") == 0,
+      "SpatialReferenceCache: different ids for different SRS, 0 without SRS");
+  const CacheType::SRSPairType ids = CacheType::GetSRSIds(utmWkt, geographicWkt);
+  nbOfFailures += Check(ids.first == CacheType::GetSRSId(utmWkt) && ids.second == CacheType::GetSRSId(geographicWkt),
+      "SpatialReferenceCache: ids of a pair of SRS");
+
+  // The origin of the rasters lies on the central meridian of UTM 31 (3 degrees
+  // east): check the longitude, latitude order, then the round trip
+  double x = OriginX, y = OriginY;
+  int success = 0;
+  CacheType::Transform(utmWkt, geographicWkt, 1, &x, &y, &success);
+  nbOfFailures += Check(success && std::abs(x - 3.0) < 1e-9 && y > 43 && y < 44,
+      "SpatialReferenceCache: projected to geographic in longitude, latitude order");
+  CacheType::Transform(geographicWkt, utmWkt, 1, &x, &y, &success);
+  nbOfFailures += Check(success && std::abs(x - OriginX) < 1e-6 && std::abs(y - OriginY) < 1e-6,
+      "SpatialReferenceCache: round trip transformation");
+
+  // Concurrent round trips
+  const unsigned int nbOfThreads = 4;
+  std::vector<std::vector<double> > xs(nbOfThreads), ys(nbOfThreads);
+  for (unsigned int t = 0; t < nbOfThreads; t++)
+    {
+    for (unsigned int i = 0; i < 100; i++)
+      {
+      xs[t].push_back(OriginX + 1000.0 * i);
+      ys[t].push_back(OriginY - 1000.0 * t);
+      }
+    }
+  TransformThreadStruct str;
+  str.SourceWkt = utmWkt;
+  str.TargetWkt = geographicWkt;
+  str.X = &xs;
+  str.Y = &ys;
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(nbOfThreads);
+  threader->SetSingleMethod(TransformThreaderCallback, &str);
+  threader->SingleMethodExecute();
+  bool concurrentOk = true;
+  for (unsigned int t = 0; t < nbOfThreads; t++)
+    {
+    for (unsigned int i = 0; i < 100; i++)
+      {
+      concurrentOk = concurrentOk && std::abs(xs[t][i] - (OriginX + 1000.0 * i)) < 1e-3 &&
+          std::abs(ys[t][i] - (OriginY - 1000.0 * t)) < 1e-3;
+      }
+    }
+  nbOfFailures += Check(concurrentOk, "SpatialReferenceCache: concurrent round trip transformations");
+
+  return nbOfFailures;
+}
+
+/** Runs all the behaviour checks. Returns the number of failures */
+unsigned int RunChecks(const ParametersType & params)
+{
+  const std::string directory = params.DataDirectory + "/checks";
+  itksys::SystemTools::MakeDirectory(directory.c_str());
+
+  unsigned int nbOfFailures = 0;
+  nbOfFailures += CheckDatasetHandlePool(directory);
+  nbOfFailures += CheckCompositing();
+  nbOfFailures += CheckRegionCatalogComparator();
+  nbOfFailures += CheckSpatialReferenceCache();
+  return nbOfFailures;
+}
+
+/*
+ * Baseline comparison
+ */
+
+/** Returns the raw value of a key of a one-line JSON object */
+std::string GetJSONValue(const std::string & line, const std::string & key)
+{
+  const std::string pattern = "\"" + key + "\": ";
+  std::string::size_type pos = line.find(pattern);
+  if (pos == std::string::npos)
+    {
+    return "";
+    }
+  pos += pattern.size();
+  if (pos < line.size() && line[pos] == '"')
+    {
+    return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+    }
+  return line.substr(pos, line.find_first_of(",}", pos) - pos);
+}
+
+/** Compares results with the baseline. Returns the number of regressions */
+unsigned int CompareWithBaseline(const std::vector<ResultType> & results, const ParametersType & params)
+{
+  std::ifstream is(params.Baseline.c_str());
+  if (!is)
+    {
+    std::cerr << "Unable to read baseline " << params.Baseline << std::endl;
+    return 1;
+    }
+
+  typedef std::pair<std::string, unsigned int> KeyType;
+  std::map<KeyType, double> baseline;
+  std::string line;
+  while (std::getline(is, line))
+    {
+    if (line.empty())
+      continue;
+    if (std::atoi(GetJSONValue(line, "size").c_str()) != static_cast<int>(params.Size))
+      continue;
+    KeyType key(GetJSONValue(line, "case"), std::atoi(GetJSONValue(line, "threads").c_str()));
+    baseline[key] = std::atof(GetJSONValue(line, "seconds").c_str());
+    }
+
+  unsigned int nbOfRegressions = 0;
+  for (unsigned int i = 0; i < results.size(); i++)
+    {
+    std::map<KeyType, double>::const_iterator it =
+        baseline.find(KeyType(results[i].Case, results[i].Threads));
+    if (it == baseline.end() || it->second <= 0)
+      {
+      std::cout << "[ NEW        ] " << results[i].Case << " (" << results[i].Threads << " threads)" << std::endl;
+      continue;
+      }
+    const double ratio = results[i].Seconds / it->second;
+    const bool regression = ratio > 1.0 + params.Tolerance;
+    std::cout << (regression ? "[ REGRESSION ] " : "[ OK         ] ") << results[i].Case
+        << " (" << results[i].Threads << " threads): " << results[i].Seconds << "s vs "
+        << it->second << "s (x" << ratio << ")" << std::endl;
+    if (regression)
+      nbOfRegressions++;
+    }
+  return nbOfRegressions;
+}
+
+void Usage(const char * program)
+{
+  std::cerr << "Usage: " << program << " <data directory> [options]\n"
+      << "  --size N          size of the synthetic rasters (default 4096)\n"
+      << "  --polygons N      number of random polygons (default 5000)\n"
+      << "  --threads 1,2,4   numbers of threads (default 1,2,4,8)\n"
+      << "  --repeats N       runs per case, the median is kept (default 3)\n"
+      << "  --ram MB          available RAM for streaming (default 256)\n"
+      << "  --seed N          seed of the synthetic inputs (default 42)\n"
+      << "  --output FILE     JSON lines results (default: standard output)\n"
+      << "  --baseline FILE   JSON lines results to compare with\n"
+      << "  --tolerance T     allowed slowdown over the baseline (default 0.15)\n"
+      << "  --check           run the behaviour checks instead of the benchmark" << std::endl;
+}
+
+bool ParseParameters(int argc, char * argv[], ParametersType & params)
+{
+  if (argc < 2)
+    {
+    return false;
+    }
+
+  params.DataDirectory = argv[1];
+  params.Size = 4096;
+  params.NumberOfPolygons = 5000;
+  params.Repeats = 3;
+  params.RAM = 256;
+  params.Seed = 42;
+  params.Tolerance = 0.15;
+  params.Check = false;
+
+  std::string threads = "1,2,4,8";
+  for (int i = 2; i < argc; i++)
+    {
+    const std::string option(argv[i]);
+    if (option == "--check")
+      {
+      params.Check = true;
+      continue;
+      }
+    if (i + 1 >= argc)
+      return false;
+    const std::string value(argv[++i]);
+    if (option == "--size")
+      params.Size = std::atoi(value.c_str());
+    else if (option == "--polygons")
+      params.NumberOfPolygons = std::atoi(value.c_str());
+    else if (option == "--threads")
+      threads = value;
+    else if (option == "--repeats")
+      params.Repeats = std::atoi(value.c_str());
+    else if (option == "--ram")
+      params.RAM = std::atoi(value.c_str());
+    else if (option == "--seed")
+      params.Seed = std::atoi(value.c_str());
+    else if (option == "--output")
+      params.Output = value;
+    else if (option == "--baseline")
+      params.Baseline = value;
+    else if (option == "--tolerance")
+      params.Tolerance = std::atof(value.c_str());
+    else
+      return false;
+    }
+
+  std::istringstream is(threads);
+  std::string token;
+  while (std::getline(is, token, ','))
+    {
+    if (std::atoi(token.c_str()) > 0)
+      params.Threads.push_back(std::atoi(token.c_str()));
+    }
+
+  return params.Size >= 256 && params.Repeats > 0 && !params.Threads.empty();
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char * argv[])
+{
+  ParametersType params;
+  if (!ParseParameters(argc, argv, params))
+    {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  GDALAllRegister();
+  OGRRegisterAll();
+
+  try
+    {
+    if (params.Check)
+      {
+      const unsigned int nbOfFailures = RunChecks(params);
+      std::cout << nbOfFailures << " failed checks" << std::endl;
+      return nbOfFailures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+      }
+
+    // Synthetic inputs (names depend on the size and seed, so that they are
+    // generated only once)
+    std::ostringstream prefix;
+    prefix << params.DataDirectory << "/s" << params.Size << "_seed" << params.Seed;
+    const std::string floatFile = prefix.str() + "_float.tif";
+    const std::string uint16File = prefix.str() + "_uint16.tif";
+    const std::string labelFile = prefix.str() + "_labels.tif";
+    const std::string tilesDirectory = prefix.str() + "_tiles";
+
+    itksys::SystemTools::MakeDirectory(params.DataDirectory.c_str());
+    if (!itksys::SystemTools::FileExists(floatFile.c_str()))
+      GenerateFloatImage(floatFile, params);
+    if (!itksys::SystemTools::FileExists(uint16File.c_str()))
+      GenerateUInt16Image(uint16File, params);
+    if (!itksys::SystemTools::FileExists(labelFile.c_str()))
+      GenerateLabelImage(labelFile, params);
+    if (!itksys::SystemTools::FileExists(tilesDirectory.c_str()))
+      GenerateTiles(tilesDirectory, params);
+    VectorDataType::Pointer polygons = GeneratePolygons(params);
+
+    // Run the cases
+    typedef std::pair<std::string, std::function<RunType()> > CaseType;
+    std::vector<CaseType> cases;
+    cases.push_back(CaseType("MeanResampleImageFilter/float",
+        [&]() { return RunMeanResample<FloatImageType>(floatFile, params); }));
+    cases.push_back(CaseType("MeanResampleImageFilter/uint16",
+        [&]() { return RunMeanResample<UInt16ImageType>(uint16File, params); }));
+    cases.push_back(CaseType("CacheLessLabelImageToVectorData/labels",
+        [&]() { return RunVectorize(labelFile, params); }));
+    cases.push_back(CaseType("VectorDataToLabelImageCustomFilter/polygons",
+        [&]() { return RunRasterize(polygons, params); }));
+    cases.push_back(CaseType("MosaicFromDirectoryHandler/tiles",
+        [&]() { return RunMosaic(tilesDirectory, params); }));
+
+    std::vector<ResultType> results;
+    for (unsigned int c = 0; c < cases.size(); c++)
+      {
+      const unsigned int first = results.size();
+      for (unsigned int t = 0; t < params.Threads.size(); t++)
+        {
+        results.push_back(Measure(cases[c].first, params.Threads[t], params, cases[c].second));
+
+        // Speedup relatively to the first number of threads
+        results.back().Speedup = results[first].Seconds / results.back().Seconds;
+        std::cerr << ToJSON(results.back(), params) << std::endl;
+        }
+      }
+
+    // Write the results
+    std::ofstream file;
+    if (!params.Output.empty())
+      {
+      file.open(params.Output.c_str());
+      if (!file)
+        {
+        std::cerr << "Unable to write " << params.Output << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    std::ostream & os = params.Output.empty() ? std::cout : file;
+    for (unsigned int i = 0; i < results.size(); i++)
+      {
+      os << ToJSON(results[i], params) << "\n";
+      }
+
+    if (!params.Baseline.empty() && CompareWithBaseline(results, params) > 0)
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -19,6 +19,8 @@
 #include "otbStreamingManager.h"
 #include "otbLabelImageToVectorDataFilter.h"
 #include "itkCommand.h"
+#include "otbPerformanceRecorder.h"
+#include "itkPreOrderTreeIterator.h"
 
 namespace otb
 {
@@ -147,6 +149,14 @@ public:
 
   std::string GetFieldName() { return vectorizeFilter->GetFieldName(); }
 
+  /** Number of features (i.e. nodes which are not root, document or folder)
+   * of a vector data */
+  static unsigned long CountFeatures(const VectorDataType * vectorData);
+
+  /** Optional performance recorder */
+  itkSetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+  itkGetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+
 protected:
   CacheLessLabelImageToVectorData();
   ~CacheLessLabelImageToVectorData() ITK_OVERRIDE;
@@ -187,6 +197,8 @@ private:
 
   typename InputImageType::Pointer  bufferedInputImage;
   typename LabelImageToVectorDataFilterType::Pointer vectorizeFilter;
+
+  PerformanceRecorder::Pointer m_PerformanceRecorder;
 };
 
 } // end namespace otb
@@ -204,6 +204,11 @@ CacheLessLabelImageToVectorData<TInputImagePixel>
   bufferedInputImage->SetSignedSpacing(inputPtr->GetSignedSpacing());
   bufferedInputImage->SetOrigin (inputPtr->GetOrigin() );
 
+  if (m_PerformanceRecorder)
+    {
+    m_PerformanceRecorder->UpdatePeakBufferBytes("CacheLessLabelImageToVectorData",
+        inputRegion.GetNumberOfPixels() * sizeof(InputImagePixelType));
+    }
 
   /** Compare the buffered region  with the inputRegion which is the largest
    * possible region or a user defined region through extended filename
@@ -255,11 +260,19 @@ CacheLessLabelImageToVectorData<TInputImagePixel>
     {
       streamRegion = m_StreamingManager->GetSplit(m_CurrentDivision);
 
+      {
+      PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "CacheLessLabelImageToVectorData",
+          "upstream", m_CurrentDivision);
+      event.SetPixels(streamRegion.GetNumberOfPixels());
       inputPtr->SetRequestedRegion(streamRegion);
       inputPtr->PropagateRequestedRegion();
       inputPtr->UpdateOutputData();
+      }
 
       // Copy output in buffer
+      PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "CacheLessLabelImageToVectorData",
+          "copy", m_CurrentDivision);
+      event.SetPixels(streamRegion.GetNumberOfPixels());
       ConstIteratorType inIt(inputPtr, streamRegion);
       IteratorType outIt(bufferedInputImage, streamRegion);
       for (inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++outIt, ++inIt)
@@ -270,10 +283,19 @@ CacheLessLabelImageToVectorData<TInputImagePixel>
     }
 
   // Vectorize the buffered image
+  {
+  PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "CacheLessLabelImageToVectorData",
+      "vectorize");
+  event.SetPixels(inputRegion.GetNumberOfPixels());
   vectorizeFilter = LabelImageToVectorDataFilterType::New();
   vectorizeFilter->SetInput(bufferedInputImage);
   vectorizeFilter->SetInputMask(bufferedInputImage);
   vectorizeFilter->Update();
+  if (m_PerformanceRecorder)
+    {
+    event.SetFeatures(CountFeatures(vectorizeFilter->GetOutput()));
+    }
+  }
   this->GraftOutput( vectorizeFilter->GetOutput() );
 
   /**
@@ -302,6 +324,24 @@ CacheLessLabelImageToVectorData<TInputImagePixel>
  }
 
 
+template <class TInputImagePixel>
+unsigned long
+CacheLessLabelImageToVectorData<TInputImagePixel>
+::CountFeatures(const VectorDataType * vectorData)
+ {
+  typedef typename VectorDataType::DataTreeType DataTreeType;
+  unsigned long nbOfFeatures = 0;
+  itk::PreOrderTreeIterator<DataTreeType> it(const_cast<DataTreeType *>(vectorData->GetDataTree()));
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    if (!it.Get()->IsRoot() && !it.Get()->IsDocument() && !it.Get()->IsFolder())
+      {
+      nbOfFeatures++;
+      }
+    }
+  return nbOfFeatures;
+ }
+
 } // end namespace otb
 
 #endif
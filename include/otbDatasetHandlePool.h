@@ -0,0 +1,155 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbDatasetHandlePool_H_
+#define otbDatasetHandlePool_H_
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+#include "otbImageFileReader.h"
+
+#include <list>
+#include <vector>
+#include <string>
+
+namespace otb
+{
+
+/** \class DatasetHandlePool
+ * \brief Bounded pool of opened image files.
+ *
+ * Each file added to the pool gets a handle. Acquire() returns an up to date
+ * reader for a handle, opening the file if needed. At most m_Capacity files
+ * are kept open: when the capacity is exceeded, the least recently used
+ * reader is released, which closes its dataset and frees its block cache.
+ * A capacity of 0 means no limit. A reader handed out by Acquire() stays
+ * open after its eviction until the caller releases it, so the number of
+ * opened files can temporarily exceed the capacity.
+ *
+ * The image information (regions, spacing, origin, metadata) of each file is
+ * kept when its reader is released, so that the pipeline can be set up
+ * without reopening the files.
+ *
+ * Files are opened outside of the pool lock, so that several threads can
+ * acquire different files concurrently.
+ *
+ * Counters of hits (file already open), misses (first opening) and reopens
+ * (opening of a previously released file) help to size the pool.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+template <class TImage>
+class ITK_EXPORT DatasetHandlePool : public itk::Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef DatasetHandlePool                     Self;
+  typedef itk::Object                           Superclass;
+  typedef itk::SmartPointer<Self>               Pointer;
+  typedef itk::SmartPointer<const Self>         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(DatasetHandlePool, itk::Object);
+
+  /** Typedefs for image reader */
+  typedef TImage                                ImageType;
+  typedef typename ImageType::Pointer           ImagePointerType;
+  typedef otb::ImageFileReader<ImageType>       ReaderType;
+  typedef typename ReaderType::Pointer          ReaderPointerType;
+  typedef unsigned int                          HandleType;
+
+  /** Maximum number of opened files (0 means no limit) */
+  itkGetMacro(Capacity, unsigned int);
+  void SetCapacity(unsigned int capacity);
+
+  /** Counters */
+  itkGetMacro(NumberOfHits, unsigned long);
+  itkGetMacro(NumberOfMisses, unsigned long);
+  itkGetMacro(NumberOfReopens, unsigned long);
+  void ResetCounters();
+
+  /** Add a file to the pool and returns its handle */
+  HandleType AddFile(const std::string & filename);
+
+  /** Hand a reader already opened by the caller over to the pool, which keeps
+   * it within the capacity */
+  void SetReader(HandleType handle, ReaderType * reader);
+
+  /** Returns a reader for the given handle, opening the file if needed. The
+   * file information is read under the ImageInformationMutex */
+  ReaderPointerType Acquire(HandleType handle);
+
+  /** Returns the image information of the given handle */
+  const ImageType * GetInformation(HandleType handle);
+
+  /** Returns the filename of the given handle */
+  std::string GetFileName(HandleType handle) const { return m_FileNames[handle]; }
+
+  /** Number of files in the pool */
+  unsigned int GetNumberOfFiles() const { return m_FileNames.size(); }
+
+  /** Number of files currently opened */
+  unsigned int GetNumberOfOpenedFiles() const { return m_LRU.size(); }
+
+  /** Release all readers and remove all files */
+  void Clear();
+
+protected:
+  DatasetHandlePool();
+  virtual ~DatasetHandlePool() {};
+
+  void PrintSelf(std::ostream& os, itk::Indent indent) const;
+
+  /** Register a newly opened reader. Must be called with the lock held */
+  void Insert(HandleType handle, ReaderType * reader);
+
+  /** Put the reader of the handle in front of the LRU list, and release the
+   * least recently used readers exceeding the capacity */
+  void Touch(HandleType handle);
+  void Evict();
+
+  /** Keep the information of the image read by the reader */
+  void StoreInformation(HandleType handle, ReaderType * reader);
+
+private:
+  DatasetHandlePool(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  typedef std::list<HandleType>                 LRUListType;
+
+  unsigned int                                  m_Capacity;
+
+  std::vector<std::string>                      m_FileNames;
+  std::vector<ReaderPointerType>                m_Readers;
+  std::vector<ImagePointerType>                 m_Informations;
+  std::vector<bool>                             m_HasBeenOpened;
+  std::vector<typename LRUListType::iterator>   m_LRUPositions;
+
+  // Most recently used handles first
+  LRUListType                                   m_LRU;
+
+  unsigned long                                 m_NumberOfHits;
+  unsigned long                                 m_NumberOfMisses;
+  unsigned long                                 m_NumberOfReopens;
+
+  itk::SimpleFastMutexLock                      m_Mutex;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbDatasetHandlePool.txx"
+#endif
+
+#endif /* otbDatasetHandlePool_H_ */
@@ -0,0 +1,257 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbDatasetHandlePool_txx_
+#define otbDatasetHandlePool_txx_
+
+#include "otbDatasetHandlePool.h"
+#include "itkMutexLockHolder.h"
+#include "otbImageInformationMutex.h"
+
+namespace otb
+{
+
+template <class TImage>
+DatasetHandlePool<TImage>
+::DatasetHandlePool()
+ : m_Capacity(0),
+   m_NumberOfHits(0),
+   m_NumberOfMisses(0),
+   m_NumberOfReopens(0)
+ {
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::SetCapacity(unsigned int capacity)
+ {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  if (m_Capacity != capacity)
+    {
+    m_Capacity = capacity;
+    Evict();
+    this->Modified();
+    }
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::ResetCounters()
+ {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  m_NumberOfHits = 0;
+  m_NumberOfMisses = 0;
+  m_NumberOfReopens = 0;
+ }
+
+template <class TImage>
+typename DatasetHandlePool<TImage>::HandleType
+DatasetHandlePool<TImage>
+::AddFile(const std::string & filename)
+ {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+
+  HandleType handle = m_FileNames.size();
+  m_FileNames.push_back(filename);
+  m_Readers.push_back(ReaderPointerType());
+  m_Informations.push_back(ImagePointerType());
+  m_HasBeenOpened.push_back(false);
+  m_LRUPositions.push_back(m_LRU.end());
+
+  return handle;
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::SetReader(HandleType handle, ReaderType * reader)
+ {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  if (handle >= m_FileNames.size())
+    {
+    itkExceptionMacro(<< "Invalid handle " << handle);
+    }
+
+  if (m_Readers[handle].IsNull())
+    {
+    Insert(handle, reader);
+    }
+  else
+    {
+    Touch(handle);
+    }
+ }
+
+template <class TImage>
+typename DatasetHandlePool<TImage>::ReaderPointerType
+DatasetHandlePool<TImage>
+::Acquire(HandleType handle)
+ {
+  std::string filename;
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    if (handle >= m_FileNames.size())
+      {
+      itkExceptionMacro(<< "Invalid handle " << handle);
+      }
+
+    if (m_Readers[handle].IsNotNull())
+      {
+      m_NumberOfHits++;
+      ReaderPointerType reader = m_Readers[handle];
+      Touch(handle);
+      return reader;
+      }
+    filename = m_FileNames[handle];
+  }
+
+  // Open the file outside of the lock
+  ReaderPointerType reader = ReaderType::New();
+  reader->SetFileName(filename);
+  ImageInformationMutex::UpdateOutputInformation(reader.GetPointer());
+
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  if (m_Readers[handle].IsNotNull())
+    {
+    // Another thread opened the file in the meantime
+    m_NumberOfHits++;
+    reader = m_Readers[handle];
+    Touch(handle);
+    }
+  else
+    {
+    Insert(handle, reader);
+    }
+
+  return reader;
+ }
+
+template <class TImage>
+const typename DatasetHandlePool<TImage>::ImageType *
+DatasetHandlePool<TImage>
+::GetInformation(HandleType handle)
+ {
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    if (handle >= m_FileNames.size())
+      {
+      itkExceptionMacro(<< "Invalid handle " << handle);
+      }
+    if (m_Informations[handle].IsNotNull())
+      {
+      return m_Informations[handle];
+      }
+  }
+
+  Acquire(handle);
+
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  return m_Informations[handle];
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::Insert(HandleType handle, ReaderType * reader)
+ {
+  if (m_HasBeenOpened[handle])
+    {
+    m_NumberOfReopens++;
+    }
+  else
+    {
+    m_NumberOfMisses++;
+    }
+
+  m_Readers[handle] = reader;
+  m_HasBeenOpened[handle] = true;
+  StoreInformation(handle, reader);
+  Touch(handle);
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::Touch(HandleType handle)
+ {
+  if (m_LRUPositions[handle] != m_LRU.end())
+    {
+    m_LRU.erase(m_LRUPositions[handle]);
+    }
+  m_LRU.push_front(handle);
+  m_LRUPositions[handle] = m_LRU.begin();
+
+  Evict();
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::Evict()
+ {
+  while (m_Capacity > 0 && m_LRU.size() > m_Capacity)
+    {
+    HandleType lruHandle = m_LRU.back();
+    m_LRU.pop_back();
+    m_LRUPositions[lruHandle] = m_LRU.end();
+
+    // Releasing the reader closes the dataset
+    m_Readers[lruHandle] = ITK_NULLPTR;
+    }
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::StoreInformation(HandleType handle, ReaderType * reader)
+ {
+  if (m_Informations[handle].IsNull())
+    {
+    ImagePointerType info = ImageType::New();
+    info->CopyInformation(reader->GetOutput());
+    info->SetNumberOfComponentsPerPixel(reader->GetOutput()->GetNumberOfComponentsPerPixel());
+    info->SetMetaDataDictionary(reader->GetOutput()->GetMetaDataDictionary());
+    m_Informations[handle] = info;
+    }
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::Clear()
+ {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+  m_FileNames.clear();
+  m_Readers.clear();
+  m_Informations.clear();
+  m_HasBeenOpened.clear();
+  m_LRUPositions.clear();
+  m_LRU.clear();
+ }
+
+template <class TImage>
+void
+DatasetHandlePool<TImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+ {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Capacity: " << m_Capacity << std::endl;
+  os << indent << "Number of files: " << m_FileNames.size() << std::endl;
+  os << indent << "Number of opened files: " << m_LRU.size() << std::endl;
+  os << indent << "Number of hits: " << m_NumberOfHits << std::endl;
+  os << indent << "Number of misses: " << m_NumberOfMisses << std::endl;
+  os << indent << "Number of reopens: " << m_NumberOfReopens << std::endl;
+ }
+
+} // end namespace otb
+
+#endif /* otbDatasetHandlePool_txx_ */
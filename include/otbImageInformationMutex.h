@@ -0,0 +1,61 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbImageInformationMutex_H_
+#define otbImageInformationMutex_H_
+
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+#include "itkObjectFactoryBase.h"
+
+namespace otb
+{
+
+/** \class ImageInformationMutex
+ * \brief Process-wide lock serializing the reading of image information.
+ *
+ * ImageFileReader::UpdateOutputInformation() reads the keywordlist and the
+ * sensor model of the file (OSSIM), which is not known to be thread safe.
+ * Threads opening several files at once (e.g. probing a directory) can
+ * detect the files concurrently with ImageIOFactory::CreateImageIO(), then
+ * read the image information through UpdateOutputInformation() below.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+class ImageInformationMutex
+{
+public:
+
+  static itk::SimpleFastMutexLock & GetInstance()
+  {
+    static itk::SimpleFastMutexLock mutex;
+    return mutex;
+  }
+
+  /** Updates the output information of a reader under the lock */
+  template <class TReader>
+  static void UpdateOutputInformation(TReader * reader)
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(GetInstance());
+    reader->UpdateOutputInformation();
+  }
+
+  /** Loads the object factories (lazily loaded by ITK, which is not thread
+   * safe). Call it before creating readers from several threads */
+  static void InitializeFactories()
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(GetInstance());
+    itk::ObjectFactoryBase::GetRegisteredFactories();
+  }
+};
+
+} // end namespace otb
+
+#endif /* otbImageInformationMutex_H_ */
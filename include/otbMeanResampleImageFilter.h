@@ -21,6 +21,14 @@
 // No data
 #include "otbNoDataHelper.h"
 
+// Input blocks
+#include "otbMetaDataKey.h"
+#include "itkMetaDataObject.h"
+#include <set>
+
+// Instrumentation
+#include "otbPerformanceRecorder.h"
+
 namespace otb
 {
 
@@ -28,6 +36,17 @@ namespace otb
  * \class MeanResampleImageFilter
  * \brief This filter decimates an input image using the mean value of the pixels neighborhood.
  *
+ * The output tile hint is set so that output tiles match whole blocks of the
+ * input file (the input block size is taken from the input tile hint, or set
+ * with SetInputBlockSize()). Hence, with adaptative streaming, each input block
+ * is decoded once. GetRedundantRequestedBytes() reports the bytes of input blocks
+ * requested more than once during the last update (the counters are reset by
+ * UpdateOutputInformation(), which a writer calls at the start of each
+ * Update()). These bytes are counted
+ * in the pixel type and number of components of the filter input, which may
+ * differ from the blocks decoded from the file (e.g. after a channel
+ * extraction, or a cast).
+ *
  * \ingroup TimeSeriesUtils
  */
 template <class TImage>
@@ -69,6 +88,20 @@ public:
   itkSetMacro(StepX, unsigned int);
   itkSetMacro(StepY, unsigned int);
 
+  /** Size of the input file blocks (0 means: read from the input tile hint) */
+  itkSetMacro(InputBlockSize, ImageSizeType);
+  itkGetMacro(InputBlockSize, ImageSizeType);
+
+  /** Bytes of input blocks which have been requested more than once */
+  itkGetMacro(RedundantRequestedBytes, unsigned long);
+
+  /** Optional performance recorder */
+  itkSetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+  itkGetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+
+  /** Resets the requested blocks counters, then updates the output information */
+  virtual void UpdateOutputInformation();
+
 protected:
   MeanResampleImageFilter();
   virtual ~MeanResampleImageFilter() {};
@@ -77,6 +110,8 @@ protected:
 
   virtual void GenerateInputRequestedRegion(void);
 
+  virtual void BeforeThreadedGenerateData(void);
+
   virtual void ThreadedGenerateData(const ImageRegionType& outputRegionForThread,
       itk::ThreadIdType threadId);
 
@@ -90,6 +125,16 @@ private:
 
   ImagePixelValueType  m_NoDataValue;
 
+  // Input blocks
+  ImageSizeType             m_InputBlockSize;
+  ImageSizeType             m_ActualInputBlockSize;
+  std::set<unsigned long>   m_RequestedBlocks;
+  unsigned long             m_RedundantRequestedBytes;
+
+  // Instrumentation
+  PerformanceRecorder::Pointer m_PerformanceRecorder;
+  long                         m_CurrentDivision;
+
 };
 
 
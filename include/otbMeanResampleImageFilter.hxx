@@ -26,6 +26,10 @@ MeanResampleImageFilter<TImage>
   m_StepX = 1;
   m_StepY = 1;
   m_NoDataValue = 0;
+  m_InputBlockSize.Fill(0);
+  m_ActualInputBlockSize.Fill(0);
+  m_RedundantRequestedBytes = 0;
+  m_CurrentDivision = -1;
  }
 
 template <class TImage>
@@ -62,6 +66,53 @@ MeanResampleImageFilter<TImage>
   outRegion.SetSize (1, inRegion.GetSize()[1] / m_StepY);
   outputPtr->SetLargestPossibleRegion( outRegion );
 
+  // Input blocks size
+  m_ActualInputBlockSize = m_InputBlockSize;
+  if (m_ActualInputBlockSize[0] == 0 || m_ActualInputBlockSize[1] == 0)
+    {
+    unsigned int tileHintX = 0, tileHintY = 0;
+    const itk::MetaDataDictionary & inputDict = inputImage->GetMetaDataDictionary();
+    itk::ExposeMetaData<unsigned int>(inputDict, MetaDataKey::TileHintX, tileHintX);
+    itk::ExposeMetaData<unsigned int>(inputDict, MetaDataKey::TileHintY, tileHintY);
+    m_ActualInputBlockSize[0] = tileHintX;
+    m_ActualInputBlockSize[1] = tileHintY;
+    }
+
+  // Output tiles matching whole input blocks: the smallest output size
+  // which is a multiple of the input block size, once multiplied by the step
+  itk::MetaDataDictionary & outputDict = outputPtr->GetMetaDataDictionary();
+  if (m_ActualInputBlockSize[0] > 0 && m_ActualInputBlockSize[1] > 0)
+    {
+    unsigned int tileHint[2];
+    const unsigned int steps[2] = {m_StepX, m_StepY};
+    for (unsigned int dim = 0; dim < 2; ++dim)
+      {
+      unsigned int a = m_ActualInputBlockSize[dim], b = steps[dim];
+      while (b != 0)
+        {
+        unsigned int r = a % b;
+        a = b;
+        b = r;
+        }
+      tileHint[dim] = m_ActualInputBlockSize[dim] / a;
+      }
+    itk::EncapsulateMetaData<unsigned int>(outputDict, MetaDataKey::TileHintX, tileHint[0]);
+    itk::EncapsulateMetaData<unsigned int>(outputDict, MetaDataKey::TileHintY, tileHint[1]);
+    }
+
+ }
+
+template <class TImage>
+void
+MeanResampleImageFilter<TImage>
+::UpdateOutputInformation()
+ {
+  // Called at the start of each update, even when the filter is not modified
+  m_RequestedBlocks.clear();
+  m_RedundantRequestedBytes = 0;
+  m_CurrentDivision = -1;
+
+  Superclass::UpdateOutputInformation();
  }
 
 template <class TImage>
@@ -85,6 +136,56 @@ MeanResampleImageFilter<TImage>
   inputImage->SetRequestedRegion(inRegion);
  }
 
+template <class TImage>
+void
+MeanResampleImageFilter<TImage>
+::BeforeThreadedGenerateData()
+ {
+  m_CurrentDivision++;
+
+  // Grab input image
+  ImageType * inputImage = static_cast<ImageType * >(
+      Superclass::ProcessObject::GetInput(0) );
+  const ImageRegionType inRegion = inputImage->GetRequestedRegion();
+  const ImageRegionType largestRegion = inputImage->GetLargestPossibleRegion();
+  const unsigned long pixelBytes =
+      sizeof(ImagePixelValueType) * inputImage->GetNumberOfComponentsPerPixel();
+
+  if (m_PerformanceRecorder)
+    {
+    m_PerformanceRecorder->UpdatePeakBufferBytes("MeanResampleImageFilter", pixelBytes *
+        (inRegion.GetNumberOfPixels() + this->GetOutput()->GetRequestedRegion().GetNumberOfPixels()));
+    }
+
+  if (m_ActualInputBlockSize[0] == 0 || m_ActualInputBlockSize[1] == 0 ||
+      inRegion.GetNumberOfPixels() == 0)
+    {
+    return;
+    }
+
+  // Count the input blocks which have already been requested
+  const unsigned long nbBlocksX =
+      (largestRegion.GetSize()[0] + m_ActualInputBlockSize[0] - 1) / m_ActualInputBlockSize[0];
+  const unsigned long bxStart = (inRegion.GetIndex()[0] - largestRegion.GetIndex()[0]) / m_ActualInputBlockSize[0];
+  const unsigned long byStart = (inRegion.GetIndex()[1] - largestRegion.GetIndex()[1]) / m_ActualInputBlockSize[1];
+  const unsigned long bxEnd = (inRegion.GetUpperIndex()[0] - largestRegion.GetIndex()[0]) / m_ActualInputBlockSize[0];
+  const unsigned long byEnd = (inRegion.GetUpperIndex()[1] - largestRegion.GetIndex()[1]) / m_ActualInputBlockSize[1];
+  for (unsigned long by = byStart; by <= byEnd; by++)
+    for (unsigned long bx = bxStart; bx <= bxEnd; bx++)
+      {
+      if (!m_RequestedBlocks.insert(by * nbBlocksX + bx).second)
+        {
+        // Block region, cropped to the image
+        ImageRegionType blockRegion;
+        blockRegion.SetIndex(0, largestRegion.GetIndex()[0] + bx * m_ActualInputBlockSize[0]);
+        blockRegion.SetIndex(1, largestRegion.GetIndex()[1] + by * m_ActualInputBlockSize[1]);
+        blockRegion.SetSize(m_ActualInputBlockSize);
+        blockRegion.Crop(largestRegion);
+        m_RedundantRequestedBytes += blockRegion.GetNumberOfPixels() * pixelBytes;
+        }
+      }
+ }
+
 /**
  *
  */
@@ -97,6 +198,11 @@ MeanResampleImageFilter<TImage>
   // Support progress methods/callbacks
   itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels() );
 
+  // Instrumentation
+  PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "MeanResampleImageFilter", "resample",
+      m_CurrentDivision, threadId);
+  event.SetPixels(outputRegionForThread.GetNumberOfPixels());
+
   // Iterate through the thread region
   OutputImageIteratorType outputIt(this->GetOutput(), outputRegionForThread);
 
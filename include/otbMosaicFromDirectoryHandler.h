@@ -12,7 +12,7 @@
 #include "itkExceptionObject.h"
 #include "itkImageRegion.h"
 
-#include "otbStreamingSimpleMosaicFilter.h"
+#include "otbStreamingCompositingMosaicFilter.h"
 
 #include "otbImageFileReader.h"
 #include "itkDirectory.h"
@@ -23,6 +23,15 @@
 #include "otbGenericRSResampleImageFilter.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 
+#include "itkMultiThreader.h"
+
+#include "otbRegionComparator.h"
+#include "otbPooledImageFileReader.h"
+#include "otbPerformanceRecorder.h"
+#include "otbImageInformationMutex.h"
+
+#include <type_traits>
+
 namespace otb
 {
 /** \class MosaicFromDirectoryHandler
@@ -30,6 +39,33 @@ namespace otb
  * stored in the m_Directory.
  * TODO: Currently only .tif extension is supported. Might be nice to change it.
  *
+ * Files are probed (driver probe and header/keywordlist read) on a pool of
+ * m_NumberOfProbingThreads workers, which is independent from the number of
+ * threads used to process pixels. The mosaic inputs are always pushed in the
+ * sorted filenames order, so that the output does not depend on the order in
+ * which files are probed.
+ *
+ * When a reference image is used, files which already lie on the reference
+ * grid (same projection, same spacing, and origin shifted by an integer number
+ * of pixels) are fed directly to the mosaic filter. Only the other ones are
+ * reprojected through a GenericRSResampleImageFilter.
+ *
+ * Files are read through a DatasetHandlePool: at most
+ * m_MaximumNumberOfOpenedFiles files are kept open (0 means no limit), the
+ * least recently used ones being closed and reopened on demand when a
+ * streamed region needs them. Use GetDatasetHandlePool() to get the
+ * hit/miss/reopen counters.
+ *
+ * When TOutputImage is an otb::Image, the first channel of the mosaic is
+ * extracted. When TOutputImage is an otb::VectorImage (of the same pixel
+ * type), all components are produced in one single pass.
+ *
+ * Overlapping files are composited in the same streamed pass, with the
+ * strategy set by SetCompositingStrategy() (see
+ * StreamingCompositingMosaicFilter). The default is LAST_VALID. With the
+ * PRIORITY strategy, the priority of each file is given by the priority
+ * function, which defaults to the acquisition date parsed from the filename
+ * (see DateFromFileName()).
  *
  * \ingroup OTBMosaic
  *
@@ -59,19 +95,35 @@ public:
 
   /** Typedefs for mosaic filter */
   typedef otb::VectorImage<OutputImagePixelType>        InternalMaskImageType;
-  typedef otb::StreamingSimpleMosaicFilter<
+  typedef otb::StreamingCompositingMosaicFilter<
       InternalMaskImageType>                            MosaicFilterType;
   typedef typename MosaicFilterType::Pointer            MosaicFilterPointerType;
+  typedef typename MosaicFilterType::CompositingStrategyType CompositingStrategyType;
+
+  /** Function giving the priority of a file (PRIORITY compositing) */
+  typedef double (*PriorityFunctionType)(const std::string & filename);
 
   /** Typedefs for image reader */
   typedef otb::ImageFileReader<InternalMaskImageType>   ReaderType;
   typedef typename ReaderType::Pointer                  ReaderPointerType;
 
+  /** Typedefs for the pool of opened files */
+  typedef otb::DatasetHandlePool<InternalMaskImageType> DatasetHandlePoolType;
+  typedef typename DatasetHandlePoolType::Pointer       DatasetHandlePoolPointerType;
+  typedef otb::PooledImageFileReader<
+      InternalMaskImageType>                            PooledReaderType;
+  typedef typename PooledReaderType::Pointer            PooledReaderPointerType;
+
   /** Typedefs for casting the image */
   typedef otb::MultiToMonoChannelExtractROI<
       OutputImagePixelType, OutputImagePixelType>       CastFilterType;
   typedef typename CastFilterType::Pointer              CastFilterPointerType;
 
+  /** Typedefs for the last filter of the internal pipeline */
+  typedef itk::ImageSource<TOutputImage>                OutputSourceType;
+  typedef typename std::is_same<
+      TOutputImage, InternalMaskImageType>::type        IsVectorOutputType;
+
   /** Typedefs for image reprojection */
   typedef otb::GenericRSResampleImageFilter<
       InternalMaskImageType, InternalMaskImageType>     ResamplerType;
@@ -79,6 +131,10 @@ public:
   typedef itk::NearestNeighborInterpolateImageFunction<
       InternalMaskImageType, double>                    NNInterpolatorType;
 
+  /** Typedefs for grid comparison */
+  typedef otb::RegionComparator<
+      InternalMaskImageType, TReferenceImage>           RegionComparatorType;
+
   /** Input directory accessors */
   itkGetMacro(Directory, std::string);
   itkSetMacro(Directory, std::string);
@@ -90,6 +146,31 @@ public:
   void SetReferenceImage(TReferenceImage * ptr){m_RefImagePtr = ptr;}
   itkSetMacro(UseReferenceImage, bool);
 
+  /** Number of workers used to probe the files of the directory */
+  itkSetMacro(NumberOfProbingThreads, unsigned int);
+  itkGetMacro(NumberOfProbingThreads, unsigned int);
+
+  /** Maximum number of simultaneously opened files (0 means no limit) */
+  itkSetMacro(MaximumNumberOfOpenedFiles, unsigned int);
+  itkGetMacro(MaximumNumberOfOpenedFiles, unsigned int);
+
+  /** Compositing of overlapping files */
+  itkSetMacro(CompositingStrategy, CompositingStrategyType);
+  itkGetMacro(CompositingStrategy, CompositingStrategyType);
+  itkSetMacro(PriorityFunction, PriorityFunctionType);
+  itkGetMacro(PriorityFunction, PriorityFunctionType);
+
+  /** Default priority function: returns the first 8 digits sequence of the
+   * file name (e.g. YYYYMMDD) as a number, or 0 if there is none */
+  static double DateFromFileName(const std::string & filename);
+
+  /** Pool of opened files */
+  DatasetHandlePoolType * GetDatasetHandlePool() { return m_DatasetHandlePool; }
+
+  /** Optional performance recorder */
+  itkSetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+  itkGetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+
   /** Prepare image allocation at the first call of the pipeline processing */
   virtual void GenerateOutputInformation(void);
 
@@ -100,6 +181,36 @@ protected:
   MosaicFromDirectoryHandler();
   virtual ~MosaicFromDirectoryHandler();
 
+  /** Open the file and read its information. Returns a null pointer if the
+   * file can't be read as an image. The file is detected concurrently, but its
+   * information is read under the ImageInformationMutex */
+  virtual ReaderPointerType ProbeFile(const std::string & filename);
+
+  /** Returns true if the image lies on the grid of the reference image,
+   * i.e. does not need to be resampled */
+  virtual bool IsOnReferenceGrid(const InternalMaskImageType * image);
+
+  /** Returns the filter producing the output: the mosaic filter itself for
+   * vector images, the channel extraction filter otherwise */
+  OutputSourceType * GetOutputFilter(std::true_type);
+  OutputSourceType * GetOutputFilter(std::false_type);
+
+  /** Static function used as a "callback" by the MultiThreader to probe files */
+  static ITK_THREAD_RETURN_TYPE ProbeThreaderCallback(void *arg);
+
+  /** Internal structure used for passing data to the probing threads */
+  struct ProbeThreadStruct
+  {
+    Self *                            Filter;
+    const std::vector<std::string> *  Filenames;
+    std::vector<unsigned char> *      IsImage;
+    std::vector<std::string> *        Errors;
+  };
+
+  /** Probes the i-th file of the struct, recording its errors (used by both
+   * the threaded and the sequential probing) */
+  static void ProbeFileOfStruct(ProbeThreadStruct * str, unsigned int i, itk::ThreadIdType threadId);
+
   // Masks directory
   std::string                       m_Directory;
 
@@ -111,13 +222,27 @@ protected:
   // Internal filters
   MosaicFilterPointerType           mosaicFilter;
   CastFilterPointerType             castFilter;
-  std::vector<ReaderPointerType>    readers;
+  std::vector<PooledReaderPointerType> readers;
   std::vector<ResamplerPointerType> resamplers;
 
   // Reference image pointer
   bool                              m_UseReferenceImage;
   TReferenceImage *                 m_RefImagePtr;
 
+  // Number of threads used to probe files
+  unsigned int                      m_NumberOfProbingThreads;
+
+  // Compositing
+  CompositingStrategyType           m_CompositingStrategy;
+  PriorityFunctionType              m_PriorityFunction;
+
+  // Pool of opened files
+  DatasetHandlePoolPointerType      m_DatasetHandlePool;
+  unsigned int                      m_MaximumNumberOfOpenedFiles;
+
+  // Performance recorder
+  PerformanceRecorder::Pointer      m_PerformanceRecorder;
+
 private:
 
   MosaicFromDirectoryHandler(const Self &); //purposely not implemented
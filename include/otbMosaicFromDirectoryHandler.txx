@@ -11,6 +11,10 @@
 #include "otbMosaicFromDirectoryHandler.h"
 #include "otbImageFileWriter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
 namespace otb
 {
 
@@ -22,6 +26,11 @@ MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
   castFilter = CastFilterType::New();
   m_UseReferenceImage = false;
   m_RefImagePtr = 0;
+  m_NumberOfProbingThreads = 8;
+  m_DatasetHandlePool = DatasetHandlePoolType::New();
+  m_MaximumNumberOfOpenedFiles = 0;
+  m_CompositingStrategy = MosaicFilterType::LAST_VALID;
+  m_PriorityFunction = &Self::DateFromFileName;
  }
 
 template <class TOutputImage, class TReferenceImage>
@@ -54,26 +63,77 @@ MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
   readers.clear();
   resamplers.clear();
 
-  // Browse the directory
+  // Browse the directory, sorting filenames to keep the mosaic inputs order
+  // deterministic
+  std::vector<std::string> filenames;
   for (unsigned int i = 0; i < dir->GetNumberOfFiles(); i++)
     {
     const char *filename = dir->GetFile(i);
     std::string sfilename(filename);
-    sfilename = m_Directory + sfilename;
+    filenames.push_back(m_Directory + sfilename);
+    }
+  std::sort(filenames.begin(), filenames.end());
+
+  // Fill the pool (the handle of each file is its position in filenames)
+  m_DatasetHandlePool->Clear();
+  m_DatasetHandlePool->SetCapacity(m_MaximumNumberOfOpenedFiles);
+  for (unsigned int i = 0; i < filenames.size(); i++)
+    {
+    m_DatasetHandlePool->AddFile(filenames[i]);
+    }
+
+  // Probe the files
+  std::vector<unsigned char> isImage(filenames.size(), 0);
+  std::vector<std::string> probeErrors(filenames.size());
+
+  ProbeThreadStruct str;
+  str.Filter = this;
+  str.Filenames = &filenames;
+  str.IsImage = &isImage;
+  str.Errors = &probeErrors;
 
-    // Try to read the file
-    otb::ImageIOBase::Pointer imageIO =
-        otb::ImageIOFactory::CreateImageIO(sfilename.c_str(),otb::ImageIOFactory::ReadMode);
-    if( imageIO.IsNotNull() )
+  unsigned int nbOfProbingThreads = std::max(1u, m_NumberOfProbingThreads);
+  nbOfProbingThreads = std::min(nbOfProbingThreads, static_cast<unsigned int>(filenames.size()));
+  if (nbOfProbingThreads > 1)
+    {
+    ImageInformationMutex::InitializeFactories();
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads(nbOfProbingThreads);
+    threader->SetSingleMethod(this->ProbeThreaderCallback, &str);
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    for (unsigned int i = 0; i < filenames.size(); i++)
       {
-        // create reader
-        ReaderPointerType reader = ReaderType::New();
-        reader->SetFileName(sfilename);
+      ProbeFileOfStruct(&str, i, 0);
+      }
+    }
+
+  // Gather the results in the filenames order
+  std::vector<double> priorities;
+  for (unsigned int i = 0; i < filenames.size(); i++)
+    {
+    if (!probeErrors[i].empty())
+      {
+      itkExceptionMacro(<< "Unable to read file " << filenames[i] << ": " << probeErrors[i]);
+      }
+
+    if( isImage[i] )
+      {
+        PooledReaderPointerType reader = PooledReaderType::New();
+        reader->SetPool(m_DatasetHandlePool);
+        reader->SetHandle(i);
         reader->UpdateOutputInformation();
 
         readers.push_back(reader);
 
-        if (m_UseReferenceImage)
+        if (m_CompositingStrategy == MosaicFilterType::PRIORITY)
+          {
+          priorities.push_back(m_PriorityFunction(filenames[i]));
+          }
+
+        if (m_UseReferenceImage && !IsOnReferenceGrid(reader->GetOutput()))
           {
             ResamplerPointerType resampler = ResamplerType::New();
             resampler->SetInput(reader->GetOutput());
@@ -106,7 +166,7 @@ MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
       }
     else
       {
-      //      itkWarningMacro(<<"Unable to read file " << sfilename);
+      //      itkWarningMacro(<<"Unable to read file " << filenames[i]);
       }
 
     }
@@ -124,12 +184,165 @@ MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
       mosaicFilter->SetOutputSize(m_OutputSize);
     }
   mosaicFilter->SetAutomaticOutputParametersComputation(false);
+  mosaicFilter->SetCompositingStrategy(m_CompositingStrategy);
+  mosaicFilter->SetInputPriorities(priorities);
 
+  OutputSourceType * outputFilter = GetOutputFilter(IsVectorOutputType());
+  outputFilter->GraftOutput( this->GetOutput() );
+  outputFilter->UpdateOutputInformation();
+  this->GraftOutput( outputFilter->GetOutput() );
+ }
+
+template <class TOutputImage, class TReferenceImage>
+typename MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>::OutputSourceType *
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::GetOutputFilter(std::true_type)
+ {
+  return mosaicFilter;
+ }
+
+template <class TOutputImage, class TReferenceImage>
+typename MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>::OutputSourceType *
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::GetOutputFilter(std::false_type)
+ {
   castFilter->SetInput(mosaicFilter->GetOutput());
+  return castFilter;
+ }
+
+template <class TOutputImage, class TReferenceImage>
+typename MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>::ReaderPointerType
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::ProbeFile(const std::string & filename)
+ {
+  ReaderPointerType reader;
+
+  // Try to read the file
+  otb::ImageIOBase::Pointer imageIO =
+      otb::ImageIOFactory::CreateImageIO(filename.c_str(),otb::ImageIOFactory::ReadMode);
+  if( imageIO.IsNotNull() )
+    {
+    // create reader
+    reader = ReaderType::New();
+    reader->SetFileName(filename);
+    ImageInformationMutex::UpdateOutputInformation(reader.GetPointer());
+    }
+
+  return reader;
+ }
+
+template <class TOutputImage, class TReferenceImage>
+void
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::ProbeFileOfStruct(ProbeThreadStruct * str, unsigned int i, itk::ThreadIdType threadId)
+ {
+  PerformanceRecorder::ScopedEvent event(str->Filter->m_PerformanceRecorder, "MosaicFromDirectoryHandler",
+      "probe", i, threadId);
+  try
+    {
+    ReaderPointerType reader = str->Filter->ProbeFile((*str->Filenames)[i]);
+    if (reader.IsNotNull())
+      {
+      // The pool keeps the reader open only within its capacity
+      str->Filter->GetDatasetHandlePool()->SetReader(i, reader);
+      (*str->IsImage)[i] = 1;
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    (*str->Errors)[i] = err.GetDescription();
+    }
+  catch (std::exception & err)
+    {
+    (*str->Errors)[i] = err.what();
+    }
+ }
 
-  castFilter->GraftOutput( this->GetOutput() );
-  castFilter->UpdateOutputInformation();
-  this->GraftOutput( castFilter->GetOutput() );
+template <class TOutputImage, class TReferenceImage>
+bool
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::IsOnReferenceGrid(const InternalMaskImageType * image)
+ {
+  const double epsilon = 1e-6;
+
+  RegionComparatorType comparator;
+  comparator.SetImage1(const_cast<InternalMaskImageType *>(image));
+  comparator.SetImage2(m_RefImagePtr);
+
+  // Check projection
+  if (!comparator.HaveSameProjection())
+    {
+    return false;
+    }
+
+  // Check spacing and origin
+  SpacingType spacing = image->GetSignedSpacing();
+  SpacingType refSpacing = m_RefImagePtr->GetSignedSpacing();
+  PointType origin = image->GetOrigin();
+  PointType refOrigin = m_RefImagePtr->GetOrigin();
+  for (unsigned int dim = 0; dim < 2; ++dim)
+    {
+    if (std::abs(spacing[dim] - refSpacing[dim]) > epsilon * std::abs(refSpacing[dim]))
+      {
+      return false;
+      }
+
+    // The offset between origins must be an integer number of pixels
+    const double offset = (origin[dim] - refOrigin[dim]) / refSpacing[dim];
+    if (std::abs(offset - std::floor(offset + 0.5)) > epsilon)
+      {
+      return false;
+      }
+    }
+
+  return true;
+ }
+
+template <class TOutputImage, class TReferenceImage>
+double
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::DateFromFileName(const std::string & filename)
+ {
+  // Only the file name, not the directories
+  std::string name = filename.substr(filename.find_last_of('/') + 1);
+
+  unsigned int nbDigits = 0;
+  for (unsigned int i = 0; i < name.size(); i++)
+    {
+    if (name[i] >= '0' && name[i] <= '9')
+      {
+      nbDigits++;
+      if (nbDigits == 8)
+        {
+        return atof(name.substr(i - 7, 8).c_str());
+        }
+      }
+    else
+      {
+      nbDigits = 0;
+      }
+    }
+
+  return 0.0;
+ }
+
+template <class TOutputImage, class TReferenceImage>
+ITK_THREAD_RETURN_TYPE
+MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
+::ProbeThreaderCallback(void *arg)
+ {
+  itk::MultiThreader::ThreadInfoStruct * info =
+      static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  ProbeThreadStruct * str = static_cast<ProbeThreadStruct *>(info->UserData);
+
+  // Each thread probes one file over NumberOfThreads
+  const unsigned int nbOfFiles = str->Filenames->size();
+  for (unsigned int i = info->ThreadID; i < nbOfFiles; i += info->NumberOfThreads)
+    {
+    ProbeFileOfStruct(str, i, info->ThreadID);
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
  }
 
 template <class TOutputImage, class TReferenceImage>
@@ -137,9 +350,21 @@ void
 MosaicFromDirectoryHandler<TOutputImage, TReferenceImage>
 ::GenerateData()
  {
-  castFilter->GraftOutput( this->GetOutput() );
-  castFilter->Update();
-  this->GraftOutput( castFilter->GetOutput() );
+  const typename TOutputImage::RegionType requestedRegion = this->GetOutput()->GetRequestedRegion();
+  PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "MosaicFromDirectoryHandler",
+      "generate");
+  event.SetPixels(requestedRegion.GetNumberOfPixels());
+  if (m_PerformanceRecorder)
+    {
+    m_PerformanceRecorder->UpdatePeakBufferBytes("MosaicFromDirectoryHandler",
+        requestedRegion.GetNumberOfPixels() * this->GetOutput()->GetNumberOfComponentsPerPixel()
+        * sizeof(typename TOutputImage::InternalPixelType));
+    }
+
+  OutputSourceType * outputFilter = GetOutputFilter(IsVectorOutputType());
+  outputFilter->GraftOutput( this->GetOutput() );
+  outputFilter->Update();
+  this->GraftOutput( outputFilter->GetOutput() );
  }
 
 } // end namespace otb
@@ -0,0 +1,269 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbPerformanceRecorder_H_
+#define otbPerformanceRecorder_H_
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace otb
+{
+
+/** \class PerformanceRecorder
+ * \brief Records the wall time of the processing phases of the filters.
+ *
+ * Filters of this module accept an optional PerformanceRecorder (see their
+ * SetPerformanceRecorder() method). When one is set, each phase of the
+ * processing (e.g. upstream pipeline, copy, vectorize, rasterize, file probe)
+ * is recorded as an event, with its division, thread, start time, duration,
+ * and number of pixels and features processed. The peak size of the buffers
+ * allocated by the filters is also recorded.
+ *
+ * Events can be written as a JSON report (with a per-phase summary giving
+ * pixels/s and features/s), or as a Chrome trace (chrome://tracing).
+ *
+ * When no recorder is set, filters only test a null pointer.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+class PerformanceRecorder : public itk::Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef PerformanceRecorder                   Self;
+  typedef itk::Object                           Superclass;
+  typedef itk::SmartPointer<Self>               Pointer;
+  typedef itk::SmartPointer<const Self>         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PerformanceRecorder, itk::Object);
+
+  /** A recorded event */
+  struct EventType
+  {
+    std::string         Name;       // Filter name
+    std::string         Phase;      // Processing phase
+    long                Division;   // Division (or file), -1 if none
+    itk::ThreadIdType   Thread;
+    double              Start;      // Microseconds since the recorder creation
+    double              Duration;   // Microseconds
+    unsigned long       Pixels;
+    unsigned long       Features;
+  };
+
+  /** Records an event during its lifetime. Does nothing if the recorder is null */
+  class ScopedEvent
+  {
+  public:
+    ScopedEvent(PerformanceRecorder * recorder, const char * name, const char * phase,
+        long division = -1, itk::ThreadIdType thread = 0)
+    : m_Recorder(recorder), m_Name(name), m_Phase(phase), m_Division(division),
+      m_Thread(thread), m_Start(0), m_Pixels(0), m_Features(0)
+    {
+      if (m_Recorder)
+        m_Start = m_Recorder->Now();
+    }
+
+    ~ScopedEvent()
+    {
+      if (m_Recorder)
+        m_Recorder->AddEvent(m_Name, m_Phase, m_Division, m_Thread, m_Start,
+            m_Recorder->Now() - m_Start, m_Pixels, m_Features);
+    }
+
+    void SetPixels(unsigned long pixels) {m_Pixels = pixels;}
+    void SetFeatures(unsigned long features) {m_Features = features;}
+
+  private:
+    ScopedEvent(const ScopedEvent &); //purposely not implemented
+    void operator=(const ScopedEvent&); //purposely not implemented
+
+    PerformanceRecorder * m_Recorder;
+    const char *          m_Name;
+    const char *          m_Phase;
+    long                  m_Division;
+    itk::ThreadIdType     m_Thread;
+    double                m_Start;
+    unsigned long         m_Pixels;
+    unsigned long         m_Features;
+  };
+
+  /** Microseconds since the recorder creation */
+  double Now() const
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_Origin).count();
+  }
+
+  /** Records an event */
+  void AddEvent(const std::string & name, const std::string & phase, long division,
+      itk::ThreadIdType thread, double start, double duration,
+      unsigned long pixels, unsigned long features)
+  {
+    EventType event;
+    event.Name = name;
+    event.Phase = phase;
+    event.Division = division;
+    event.Thread = thread;
+    event.Start = start;
+    event.Duration = duration;
+    event.Pixels = pixels;
+    event.Features = features;
+
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    m_Events.push_back(event);
+  }
+
+  /** Records the size of a buffer allocated by a filter */
+  void UpdatePeakBufferBytes(const std::string & name, unsigned long bytes)
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    if (bytes > m_PeakBufferBytes[name])
+      m_PeakBufferBytes[name] = bytes;
+  }
+
+  /** Copy of the events recorded so far (taken under the lock, since the
+   * filters may still be recording) */
+  std::vector<EventType> GetEvents()
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    return m_Events;
+  }
+
+  /** Peak size of the buffers allocated by a filter (0 if none recorded) */
+  unsigned long GetPeakBufferBytes(const std::string & name)
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    std::map<std::string, unsigned long>::const_iterator it = m_PeakBufferBytes.find(name);
+    return it != m_PeakBufferBytes.end() ? it->second : 0;
+  }
+
+  void Clear()
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    m_Events.clear();
+    m_PeakBufferBytes.clear();
+  }
+
+  /** Writes the events, a per-phase summary and the peak buffer sizes */
+  void WriteJSON(const std::string & filename)
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    std::ofstream os(filename.c_str());
+    if (!os)
+      {
+      itkExceptionMacro(<< "Unable to write " << filename);
+      }
+
+    os << "{\n  \"events\": [";
+    for (unsigned int i = 0; i < m_Events.size(); i++)
+      {
+      const EventType & e = m_Events[i];
+      os << (i > 0 ? "," : "") << "\n    {\"name\": \"" << e.Name << "\", \"phase\": \"" << e.Phase
+         << "\", \"division\": " << e.Division << ", \"thread\": " << e.Thread
+         << ", \"start_us\": " << e.Start << ", \"duration_us\": " << e.Duration
+         << ", \"pixels\": " << e.Pixels << ", \"features\": " << e.Features << "}";
+      }
+    os << "\n  ],\n  \"summary\": [";
+
+    // Per (name, phase) totals
+    typedef std::pair<std::string, std::string> KeyType;
+    std::map<KeyType, EventType> totals;
+    std::map<KeyType, unsigned long> counts;
+    for (unsigned int i = 0; i < m_Events.size(); i++)
+      {
+      const EventType & e = m_Events[i];
+      KeyType key(e.Name, e.Phase);
+      if (counts[key]++ == 0)
+        {
+        totals[key] = e;
+        }
+      else
+        {
+        totals[key].Duration += e.Duration;
+        totals[key].Pixels += e.Pixels;
+        totals[key].Features += e.Features;
+        }
+      }
+    bool first = true;
+    for (std::map<KeyType, EventType>::const_iterator it = totals.begin(); it != totals.end(); ++it)
+      {
+      const EventType & t = it->second;
+      const double seconds = t.Duration * 1e-6;
+      os << (first ? "" : ",") << "\n    {\"name\": \"" << t.Name << "\", \"phase\": \"" << t.Phase
+         << "\", \"count\": " << counts[it->first] << ", \"total_us\": " << t.Duration
+         << ", \"pixels_per_s\": " << (seconds > 0 ? t.Pixels / seconds : 0)
+         << ", \"features_per_s\": " << (seconds > 0 ? t.Features / seconds : 0) << "}";
+      first = false;
+      }
+    os << "\n  ],\n  \"peak_buffer_bytes\": {";
+    first = true;
+    for (std::map<std::string, unsigned long>::const_iterator it = m_PeakBufferBytes.begin();
+        it != m_PeakBufferBytes.end(); ++it)
+      {
+      os << (first ? "" : ",") << "\n    \"" << it->first << "\": " << it->second;
+      first = false;
+      }
+    os << "\n  }\n}\n";
+  }
+
+  /** Writes the events in the Chrome trace event format */
+  void WriteChromeTrace(const std::string & filename)
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(m_Mutex);
+    std::ofstream os(filename.c_str());
+    if (!os)
+      {
+      itkExceptionMacro(<< "Unable to write " << filename);
+      }
+
+    os << "{\"traceEvents\": [";
+    for (unsigned int i = 0; i < m_Events.size(); i++)
+      {
+      const EventType & e = m_Events[i];
+      os << (i > 0 ? "," : "") << "\n  {\"name\": \"" << e.Phase << "\", \"cat\": \"" << e.Name
+         << "\", \"ph\": \"X\", \"ts\": " << e.Start << ", \"dur\": " << e.Duration
+         << ", \"pid\": 0, \"tid\": " << e.Thread
+         << ", \"args\": {\"division\": " << e.Division << ", \"pixels\": " << e.Pixels
+         << ", \"features\": " << e.Features << "}}";
+      }
+    os << "\n], \"displayTimeUnit\": \"ms\"}\n";
+  }
+
+protected:
+  PerformanceRecorder() : m_Origin(std::chrono::steady_clock::now()) {}
+  virtual ~PerformanceRecorder() {}
+
+private:
+  PerformanceRecorder(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  std::chrono::steady_clock::time_point   m_Origin;
+  std::vector<EventType>                  m_Events;
+  std::map<std::string, unsigned long>    m_PeakBufferBytes;
+  itk::SimpleFastMutexLock                m_Mutex;
+};
+
+} // end namespace otb
+
+#endif /* otbPerformanceRecorder_H_ */
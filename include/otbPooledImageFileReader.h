@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbPooledImageFileReader_H_
+#define otbPooledImageFileReader_H_
+
+#include "itkImageSource.h"
+#include "otbDatasetHandlePool.h"
+
+namespace otb
+{
+
+/** \class PooledImageFileReader
+ * \brief Image source reading a file through a DatasetHandlePool.
+ *
+ * The output information is taken from the pool without opening the file.
+ * The file is only acquired from the pool when a region is requested, and the
+ * read buffer is grafted to the output. Hence the number of opened files stays
+ * bounded by the pool capacity, whatever the number of PooledImageFileReader.
+ * Empty requested regions (e.g. mosaic inputs which don't overlap the current
+ * streaming division) don't acquire the file.
+ *
+ * Note that the pool evicts readers, but doesn't close them while they are in
+ * use: a reader handed out by Acquire() stays open until its last reference
+ * is released, so the number of opened files can temporarily exceed the pool
+ * capacity.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+template <class TImage>
+class ITK_EXPORT PooledImageFileReader : public itk::ImageSource<TImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef PooledImageFileReader                 Self;
+  typedef itk::ImageSource<TImage>              Superclass;
+  typedef itk::SmartPointer<Self>               Pointer;
+  typedef itk::SmartPointer<const Self>         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PooledImageFileReader, ImageSource);
+
+  /** Typedefs for the pool */
+  typedef TImage                                ImageType;
+  typedef DatasetHandlePool<ImageType>          PoolType;
+  typedef typename PoolType::Pointer            PoolPointerType;
+  typedef typename PoolType::HandleType         HandleType;
+  typedef typename PoolType::ReaderPointerType  ReaderPointerType;
+
+  /** Pool and handle of the file to read */
+  itkSetObjectMacro(Pool, PoolType);
+  itkGetObjectMacro(Pool, PoolType);
+  itkSetMacro(Handle, HandleType);
+  itkGetMacro(Handle, HandleType);
+
+protected:
+  PooledImageFileReader();
+  virtual ~PooledImageFileReader() {};
+
+  virtual void GenerateOutputInformation(void);
+
+  virtual void GenerateData();
+
+private:
+  PooledImageFileReader(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  PoolPointerType   m_Pool;
+  HandleType        m_Handle;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbPooledImageFileReader.txx"
+#endif
+
+#endif /* otbPooledImageFileReader_H_ */
@@ -0,0 +1,77 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbPooledImageFileReader_txx_
+#define otbPooledImageFileReader_txx_
+
+#include "otbPooledImageFileReader.h"
+
+namespace otb
+{
+
+template <class TImage>
+PooledImageFileReader<TImage>
+::PooledImageFileReader()
+ : m_Handle(0)
+ {
+  this->SetNumberOfRequiredInputs(0);
+ }
+
+template <class TImage>
+void
+PooledImageFileReader<TImage>
+::GenerateOutputInformation()
+ {
+  if (m_Pool.IsNull())
+    {
+    itkExceptionMacro(<< "No dataset handle pool set");
+    }
+
+  ImageType * outputPtr = this->GetOutput();
+  const ImageType * info = m_Pool->GetInformation(m_Handle);
+
+  outputPtr->CopyInformation(info);
+  outputPtr->SetNumberOfComponentsPerPixel(info->GetNumberOfComponentsPerPixel());
+  outputPtr->SetMetaDataDictionary(info->GetMetaDataDictionary());
+ }
+
+template <class TImage>
+void
+PooledImageFileReader<TImage>
+::GenerateData()
+ {
+  ImageType * outputPtr = this->GetOutput();
+
+  // Inputs of the mosaic which don't overlap the current division get an
+  // empty requested region: don't acquire the file for them
+  if (outputPtr->GetRequestedRegion().GetNumberOfPixels() == 0)
+    {
+    outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+    outputPtr->Allocate();
+    return;
+    }
+
+  // Read the requested region with a pooled reader
+  ReaderPointerType reader = m_Pool->Acquire(m_Handle);
+  ImageType * readerOutput = reader->GetOutput();
+  readerOutput->UpdateOutputInformation();
+  readerOutput->SetRequestedRegion(outputPtr->GetRequestedRegion());
+  readerOutput->PropagateRequestedRegion();
+  readerOutput->UpdateOutputData();
+
+  // Graft the buffer, then let the reader allocate a new one next time so
+  // that the grafted buffer is not overwritten
+  this->GraftOutput(readerOutput);
+  readerOutput->ReleaseData();
+ }
+
+} // end namespace otb
+
+#endif /* otbPooledImageFileReader_txx_ */
@@ -0,0 +1,270 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbRegionCatalogComparator_H_
+#define otbRegionCatalogComparator_H_
+
+#include "itkContinuousIndex.h"
+#include "itkMacro.h"
+#include "otbRegionComparator.h"
+#include "otbSpatialReferenceCache.h"
+
+#include <vector>
+#include <map>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+
+namespace otb {
+
+/* \class RegionCatalogComparator
+ * \brief Compare the layout of a catalog of images
+ *
+ * This is the catalog-level companion of RegionComparator. The footprint of
+ * each image is computed once, then all the overlapping pairs of images are
+ * found with a sweep-line over the footprints, instead of comparing each pair
+ * of images. The footprints crossing the sweep line are indexed by their
+ * lower y, so that only the footprints which can overlap along y are tested
+ * (the search window is enlarged by the largest footprint height of the
+ * catalog). For each overlapping pair, the overlap is returned in the
+ * indices of both images.
+ *
+ * Images must share the same SRS (compared with SpatialReferenceCache):
+ * AddImage() throws an exception for an image whose SRS differs from the
+ * SRS of the catalog.
+ *
+ *  \ingroup SimpleExtractionTools
+ */
+template<class TInputImage> class RegionCatalogComparator{
+public:
+
+  typedef TInputImage                           InputImageType;
+  typedef typename InputImageType::Pointer      InputImagePointerType;
+  typedef typename InputImageType::RegionType   InputImageRegionType;
+  typedef typename InputImageType::IndexType    InputImageIndexType;
+  typedef typename InputImageType::PointType    InputImagePointType;
+
+  /* Physical footprint of an image (pixels extent) */
+  struct FootprintType
+  {
+    double xmin, xmax, ymin, ymax;
+  };
+
+  /* Overlap between images Image1 and Image2 (Image1 < Image2) */
+  struct OverlapType
+  {
+    unsigned int          Image1;
+    unsigned int          Image2;
+    InputImageRegionType  RegionInImage1;
+    InputImageRegionType  RegionInImage2;
+  };
+
+  RegionCatalogComparator() : m_SRSId(0), m_MaxHeight(0) {}
+
+  /*
+   * Adds an image to the catalog, and returns its position
+   */
+  unsigned int AddImage(InputImagePointerType im)
+  {
+    const SpatialReferenceCache::SRSIdType id = SpatialReferenceCache::GetSRSId(
+        RegionComparator<InputImageType>::GetProjectionRef(im.GetPointer()));
+    if (m_InputImages.empty())
+      {
+      m_SRSId = id;
+      }
+    else if (id != m_SRSId)
+      {
+      itkGenericExceptionMacro(<< "The SRS of image #" << m_InputImages.size()
+          << " differs from the SRS of the catalog. Reproject the images first.");
+      }
+
+    m_InputImages.push_back(im);
+    m_Footprints.push_back(ComputeFootprint(im));
+    m_MaxHeight = std::max(m_MaxHeight, m_Footprints.back().ymax - m_Footprints.back().ymin);
+    return m_InputImages.size() - 1;
+  }
+
+  unsigned int GetNumberOfImages() const {return m_InputImages.size();}
+
+  const FootprintType & GetFootprint(unsigned int i) const {return m_Footprints[i];}
+
+  void Clear()
+  {
+    m_InputImages.clear();
+    m_Footprints.clear();
+    m_SRSId = 0;
+    m_MaxHeight = 0;
+  }
+
+  /*
+   * Returns all the overlapping pairs of images, with their overlaps in the
+   * indices of both images
+   */
+  std::vector<OverlapType> ComputeOverlaps()
+  {
+    std::vector<OverlapType> overlaps;
+
+    // Sort the footprints along x
+    std::vector<unsigned int> sorted(m_Footprints.size());
+    for (unsigned int i = 0; i < sorted.size(); i++)
+      sorted[i] = i;
+    std::sort(sorted.begin(), sorted.end(), XMinCompare(m_Footprints));
+
+    // Sweep along x, keeping the footprints crossing the sweep line indexed
+    // by their ymin, and ordered by their xmax to remove them
+    typedef std::multimap<double, unsigned int>  ActiveMapType;
+    typedef std::pair<double, unsigned int>      ExpiryType;
+    ActiveMapType active;
+    std::priority_queue<ExpiryType, std::vector<ExpiryType>, std::greater<ExpiryType> > expiries;
+    for (unsigned int k = 0; k < sorted.size(); k++)
+      {
+      const unsigned int current = sorted[k];
+      const FootprintType & fp = m_Footprints[current];
+
+      // Remove the footprints which are behind the sweep line
+      while (!expiries.empty() && expiries.top().first <= fp.xmin)
+        {
+        const unsigned int expired = expiries.top().second;
+        expiries.pop();
+        std::pair<typename ActiveMapType::iterator, typename ActiveMapType::iterator> range =
+            active.equal_range(m_Footprints[expired].ymin);
+        for (typename ActiveMapType::iterator it = range.first; it != range.second; ++it)
+          {
+          if (it->second == expired)
+            {
+            active.erase(it);
+            break;
+            }
+          }
+        }
+
+      // Active footprints overlap along x: only the ones with
+      // ymin in ]fp.ymin - maxHeight, fp.ymax[ can overlap along y
+      typename ActiveMapType::iterator it = active.upper_bound(fp.ymin - m_MaxHeight);
+      typename ActiveMapType::iterator end = active.lower_bound(fp.ymax);
+      for ( ; it != end; ++it)
+        {
+        const FootprintType & other = m_Footprints[it->second];
+        if (fp.ymin < other.ymax)
+          {
+          OverlapType overlap;
+          overlap.Image1 = std::min(current, it->second);
+          overlap.Image2 = std::max(current, it->second);
+          ComputeOverlapRegions(overlap);
+          if (overlap.RegionInImage1.GetNumberOfPixels() > 0 &&
+              overlap.RegionInImage2.GetNumberOfPixels() > 0)
+            overlaps.push_back(overlap);
+          }
+        }
+
+      active.insert(std::make_pair(fp.ymin, current));
+      expiries.push(std::make_pair(fp.xmax, current));
+      }
+
+    return overlaps;
+  }
+
+  /*
+   * Converts a physical box into the region of the image covered by the box
+   */
+  InputImageRegionType FootprintToImageRegion(const FootprintType & fp, const InputImagePointerType & image) const
+  {
+    InputImagePointType pmin, pmax;
+    pmin[0] = fp.xmin;
+    pmin[1] = fp.ymin;
+    pmax[0] = fp.xmax;
+    pmax[1] = fp.ymax;
+
+    itk::ContinuousIndex<double, 2> cmin, cmax;
+    image->TransformPhysicalPointToContinuousIndex(pmin, cmin);
+    image->TransformPhysicalPointToContinuousIndex(pmax, cmax);
+
+    // Pixel k covers [k-0.5, k+0.5[ in continuous index. A small fraction of
+    // pixel absorbs the roundoff errors of the transform, so that a box edge
+    // lying on a pixel edge doesn't add a row or column of pixels
+    const double epsilon = 1e-3;
+    InputImageIndexType start;
+    typename InputImageRegionType::SizeType size;
+    for(unsigned int dim = 0; dim < 2; ++dim)
+      {
+      const double lo = std::min(cmin[dim], cmax[dim]);
+      const double hi = std::max(cmin[dim], cmax[dim]);
+      const long first = static_cast<long>(std::floor(lo - 0.5 + epsilon)) + 1;
+      const long last  = static_cast<long>(std::ceil(hi + 0.5 - epsilon)) - 1;
+      start[dim] = first;
+      size[dim]  = (last >= first) ? (last - first + 1) : 0;
+      }
+
+    InputImageRegionType region(start, size);
+    if (!region.Crop(image->GetLargestPossibleRegion()))
+      {
+      size.Fill(0);
+      region.SetSize(size);
+      }
+    return region;
+  }
+
+private:
+
+  /*
+   * Physical extent of the largest region of the image
+   */
+  static FootprintType ComputeFootprint(const InputImagePointerType & image)
+  {
+    InputImageRegionType region = image->GetLargestPossibleRegion();
+    itk::ContinuousIndex<double, 2> cstart, cend;
+    for(unsigned int dim = 0; dim < 2; ++dim)
+      {
+      cstart[dim] = region.GetIndex()[dim] - 0.5;
+      cend[dim]   = region.GetIndex()[dim] + region.GetSize()[dim] - 0.5;
+      }
+    InputImagePointType pstart, pend;
+    image->TransformContinuousIndexToPhysicalPoint(cstart, pstart);
+    image->TransformContinuousIndexToPhysicalPoint(cend, pend);
+
+    FootprintType fp;
+    fp.xmin = std::min(pstart[0], pend[0]);
+    fp.xmax = std::max(pstart[0], pend[0]);
+    fp.ymin = std::min(pstart[1], pend[1]);
+    fp.ymax = std::max(pstart[1], pend[1]);
+    return fp;
+  }
+
+  void ComputeOverlapRegions(OverlapType & overlap) const
+  {
+    const FootprintType & fp1 = m_Footprints[overlap.Image1];
+    const FootprintType & fp2 = m_Footprints[overlap.Image2];
+    FootprintType inter;
+    inter.xmin = std::max(fp1.xmin, fp2.xmin);
+    inter.xmax = std::min(fp1.xmax, fp2.xmax);
+    inter.ymin = std::max(fp1.ymin, fp2.ymin);
+    inter.ymax = std::min(fp1.ymax, fp2.ymax);
+    overlap.RegionInImage1 = FootprintToImageRegion(inter, m_InputImages[overlap.Image1]);
+    overlap.RegionInImage2 = FootprintToImageRegion(inter, m_InputImages[overlap.Image2]);
+  }
+
+  struct XMinCompare
+  {
+    XMinCompare(const std::vector<FootprintType> & fps) : m_Fps(fps) {}
+    bool operator()(unsigned int a, unsigned int b) const {return m_Fps[a].xmin < m_Fps[b].xmin;}
+    const std::vector<FootprintType> & m_Fps;
+  };
+
+  std::vector<InputImagePointerType> m_InputImages;
+  std::vector<FootprintType>         m_Footprints;
+  SpatialReferenceCache::SRSIdType   m_SRSId;
+  double                             m_MaxHeight;
+
+};
+
+}
+
+#endif /* otbRegionCatalogComparator_H_ */
@@ -26,8 +26,11 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <cmath>
 
 #include "otbRemoteSensingRegion.h"
+#include "otbSpatialReferenceCache.h"
 
 #define msg(x) do { std::cout << x << std::endl;} while(0)
 
@@ -38,6 +41,13 @@ namespace otb {
 /* \class RegionComparator
  * \brief Compare regions layout
  *
+ *  Identical WKT are the same SRS. Otherwise, projections are compared
+ *  through the ids of their canonicalized SRS (see SpatialReferenceCache),
+ *  so that equivalent SRS written differently are considered the same.
+ *  When the images have different SRS, regions are mapped by transforming
+ *  the densified edges of the region (see SetDensificationSteps()), using
+ *  the coordinate transformations cached by SpatialReferenceCache.
+ *
  *  \ingroup SimpleExtractionTools
  */
 template<class TInputImage1, class TInputImage2=TInputImage1> class RegionComparator{
@@ -53,9 +63,15 @@ public:
 
   typedef typename otb::RemoteSensingRegion<double> RSRegion;
 
+  RegionComparator() : m_DensificationSteps(20) {}
+
   void SetImage1(InputImage1PointerType im1) {m_InputImage1 = im1;}
   void SetImage2(InputImage2PointerType im2) {m_InputImage2 = im2;}
 
+  /* Number of points per edge when mapping regions across SRS */
+  void SetDensificationSteps(unsigned int steps) {m_DensificationSteps = std::max(1u, steps);}
+  unsigned int GetDensificationSteps() const {return m_DensificationSteps;}
+
   InputImage2RegionType GetOverlapInImage1Indices()
   {
     // Largest region of im2 --> region in im1
@@ -105,6 +121,19 @@ public:
       const InputImage1PointerType &sourceImage, const InputImage2PointerType &targetImage)
   {
 
+    // Images with different SRS (identical WKT don't need the SRS ids)
+    const string sourceWkt = GetProjectionRef(sourceImage.GetPointer());
+    const string targetWkt = GetProjectionRef(targetImage.GetPointer());
+    if (!sourceWkt.empty() && !targetWkt.empty() && sourceWkt != targetWkt)
+      {
+      const SpatialReferenceCache::SRSPairType ids = SpatialReferenceCache::GetSRSIds(sourceWkt, targetWkt);
+      if (ids.first != ids.second)
+        {
+        DensifiedRegionToRegion(sourceRegion, targetRegion, sourceImage, targetImage, sourceWkt, targetWkt);
+        return;
+        }
+      }
+
     // Source Region (source image indices)
     typename InputImage1RegionType::IndexType sourceRegionIndexStart = sourceRegion.GetIndex();
     typename InputImage1RegionType::IndexType sourceRegionIndexEnd;
@@ -139,6 +168,93 @@ public:
 
   }
 
+  /*
+   * Converts sourceRegion of im1 into targetRegion of im2, when im1 and im2
+   * have different SRS. The edges of the source region are densified and
+   * transformed into the target SRS, and the target region is their bounding
+   * box.
+   */
+  void DensifiedRegionToRegion(const InputImage1RegionType &sourceRegion, InputImage2RegionType &targetRegion,
+      const InputImage1PointerType &sourceImage, const InputImage2PointerType &targetImage,
+      const string &sourceWkt, const string &targetWkt)
+  {
+    // Source Region edges (source image continuous indices)
+    itk::ContinuousIndex<double, 2> start, end;
+    for(unsigned int dim = 0; dim < 2; ++dim)
+      {
+      start[dim] = sourceRegion.GetIndex()[dim] - 0.5;
+      end[dim]   = sourceRegion.GetIndex()[dim] + sourceRegion.GetSize()[dim] - 0.5;
+      }
+
+    // Densified edges (source Geo)
+    const unsigned int n = m_DensificationSteps;
+    vector<double> x, y;
+    x.reserve(4 * (n + 1));
+    y.reserve(4 * (n + 1));
+    for (unsigned int k = 0; k <= n; k++)
+      {
+      const double t = static_cast<double>(k) / static_cast<double>(n);
+      itk::ContinuousIndex<double, 2> edges[4];
+      edges[0][0] = start[0] + t * (end[0] - start[0]); edges[0][1] = start[1];
+      edges[1][0] = start[0] + t * (end[0] - start[0]); edges[1][1] = end[1];
+      edges[2][0] = start[0]; edges[2][1] = start[1] + t * (end[1] - start[1]);
+      edges[3][0] = end[0];   edges[3][1] = start[1] + t * (end[1] - start[1]);
+      for (unsigned int e = 0; e < 4; e++)
+        {
+        typename InputImage1Type::PointType geo;
+        sourceImage->TransformContinuousIndexToPhysicalPoint(edges[e], geo);
+        x.push_back(geo[0]);
+        y.push_back(geo[1]);
+        }
+      }
+
+    // Source Geo --> Target Geo
+    vector<int> success(x.size());
+    SpatialReferenceCache::Transform(sourceWkt, targetWkt, x.size(), &x[0], &y[0], &success[0]);
+
+    // Target Geo --> target image indices bounding box
+    bool found = false;
+    double lo[2], hi[2];
+    for (unsigned int i = 0; i < x.size(); i++)
+      {
+      if (!success[i])
+        continue;
+      typename InputImage2Type::PointType geo;
+      geo[0] = x[i];
+      geo[1] = y[i];
+      itk::ContinuousIndex<double, 2> cidx;
+      targetImage->TransformPhysicalPointToContinuousIndex(geo, cidx);
+      for(unsigned int dim = 0; dim < 2; ++dim)
+        {
+        lo[dim] = found ? std::min(lo[dim], cidx[dim]) : cidx[dim];
+        hi[dim] = found ? std::max(hi[dim], cidx[dim]) : cidx[dim];
+        }
+      found = true;
+      }
+
+    // Target Region (target image indices)
+    typename InputImage2RegionType::IndexType targetRegionStart;
+    typename InputImage2RegionType::SizeType targetRegionSize;
+    targetRegionStart.Fill(0);
+    targetRegionSize.Fill(0);
+    if (found)
+      {
+      for(unsigned int dim = 0; dim < 2; ++dim)
+        {
+        targetRegionStart[dim] = static_cast<long>(std::floor(lo[dim] + 0.5));
+        targetRegionSize[dim]  = static_cast<long>(std::floor(hi[dim] + 0.5)) - targetRegionStart[dim] + 1;
+        }
+      }
+    InputImage2RegionType computedInputRegion(targetRegionStart, targetRegionSize);
+
+    // Avoid extrapolation
+    if (found)
+      computedInputRegion.PadByRadius(1);
+
+    // Target Region
+    targetRegion = computedInputRegion;
+  }
+
   /*
    * Converts a RemoteSensingREgion into a ImageRegion (image1)
    */
@@ -203,22 +319,27 @@ public:
   }
   bool HaveSameProjection()
   {
-    itk::MetaDataDictionary metaData1 = m_InputImage1 -> GetMetaDataDictionary();
-    itk::MetaDataDictionary metaData2 = m_InputImage2 -> GetMetaDataDictionary();
-
-    if (metaData1.HasKey(otb::MetaDataKey::ProjectionRefKey))
-      {
-      if (metaData2.HasKey(otb::MetaDataKey::ProjectionRefKey))
-        {
-        string proj1, proj2;
-        itk::ExposeMetaData<string>(metaData1, static_cast<string>(otb::MetaDataKey::ProjectionRefKey), proj1);
-        itk::ExposeMetaData<string>(metaData2, static_cast<string>(otb::MetaDataKey::ProjectionRefKey), proj2);
-        if (proj1.compare(proj2)==0)
-          return true;
-        }
-      }
-    return false;
+    const string wkt1 = GetProjectionRef(m_InputImage1.GetPointer());
+    const string wkt2 = GetProjectionRef(m_InputImage2.GetPointer());
+    if (wkt1.empty() || wkt2.empty())
+      return false;
+    if (wkt1 == wkt2)
+      return true;
+    const SpatialReferenceCache::SRSPairType ids = SpatialReferenceCache::GetSRSIds(wkt1, wkt2);
+    return (ids.first == ids.second);
+  }
 
+  /*
+   * Returns the projection ref of an image (empty if there is none)
+   */
+  template<class TImage>
+  static string GetProjectionRef(const TImage * image)
+  {
+    string proj;
+    const itk::MetaDataDictionary & metaData = image->GetMetaDataDictionary();
+    if (metaData.HasKey(otb::MetaDataKey::ProjectionRefKey))
+      itk::ExposeMetaData<string>(metaData, static_cast<string>(otb::MetaDataKey::ProjectionRefKey), proj);
+    return proj;
   }
 
   bool HaveSameNbOfBands()
@@ -240,6 +361,8 @@ private:
   InputImage1PointerType m_InputImage1;
   InputImage2PointerType m_InputImage2;
 
+  unsigned int m_DensificationSteps;
+
 };
 
 }
@@ -0,0 +1,106 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbSparseLabelImageFileWriter_H_
+#define otbSparseLabelImageFileWriter_H_
+
+#include "itkProcessObject.h"
+#include "otbGdalDataTypeBridge.h"
+
+#include "gdal.h"
+
+#include <string>
+#include <vector>
+
+namespace otb
+{
+
+/** \class SparseLabelImageFileWriter
+ * \brief Writes the output of a label filter in a sparse tiled GeoTIFF.
+ *
+ * The output is written tile by tile. Tiles where no geometry is burnt (as
+ * reported by the IsRegionEmpty() method of the label filter, e.g.
+ * VectorDataToLabelImageCustomFilter) are neither computed nor written: they
+ * are left as sparse blocks of the GeoTIFF (SPARSE_OK=TRUE), which are read
+ * as zeros. Hence the writing time and the file size depend on the area
+ * covered by the geometries rather than on the output extent.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+template <class TLabelFilter>
+class ITK_EXPORT SparseLabelImageFileWriter : public itk::ProcessObject
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseLabelImageFileWriter            Self;
+  typedef itk::ProcessObject                    Superclass;
+  typedef itk::SmartPointer<Self>               Pointer;
+  typedef itk::SmartPointer<const Self>         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SparseLabelImageFileWriter, itk::ProcessObject);
+
+  /** Typedefs for the label filter */
+  typedef TLabelFilter                                  LabelFilterType;
+  typedef typename LabelFilterType::OutputImageType     ImageType;
+  typedef typename ImageType::RegionType                RegionType;
+  typedef typename ImageType::IndexType                 IndexType;
+  typedef typename ImageType::SizeType                  SizeType;
+  typedef typename ImageType::InternalPixelType         InternalPixelType;
+
+  /** Label filter to write */
+  void SetLabelFilter(LabelFilterType * filter) { m_LabelFilter = filter; this->Modified(); }
+
+  /** Output file name */
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Size of the output tiles (square) */
+  itkSetMacro(TileSize, unsigned int);
+  itkGetMacro(TileSize, unsigned int);
+
+  /** Additional GDAL creation option (e.g. "COMPRESS=DEFLATE") */
+  void AddCreationOption(const std::string & option) { m_CreationOptions.push_back(option); }
+
+  /** Number of tiles written and skipped during the last update */
+  itkGetMacro(NumberOfWrittenTiles, unsigned long);
+  itkGetMacro(NumberOfSkippedTiles, unsigned long);
+
+  /** Override Update() from ProcessObject because this filter
+   *  has no output. */
+  void Update() ITK_OVERRIDE;
+
+protected:
+  SparseLabelImageFileWriter();
+  virtual ~SparseLabelImageFileWriter() {};
+
+private:
+  SparseLabelImageFileWriter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  typename LabelFilterType::Pointer m_LabelFilter;
+  std::string                       m_FileName;
+  unsigned int                      m_TileSize;
+  std::vector<std::string>          m_CreationOptions;
+
+  unsigned long                     m_NumberOfWrittenTiles;
+  unsigned long                     m_NumberOfSkippedTiles;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbSparseLabelImageFileWriter.txx"
+#endif
+
+#endif /* otbSparseLabelImageFileWriter_H_ */
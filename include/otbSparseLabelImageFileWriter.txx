@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbSparseLabelImageFileWriter_txx_
+#define otbSparseLabelImageFileWriter_txx_
+
+#include "otbSparseLabelImageFileWriter.h"
+#include "cpl_string.h"
+#include "otbMacro.h"
+
+#include <sstream>
+
+namespace otb
+{
+
+template <class TLabelFilter>
+SparseLabelImageFileWriter<TLabelFilter>
+::SparseLabelImageFileWriter()
+ : m_TileSize(256),
+   m_NumberOfWrittenTiles(0),
+   m_NumberOfSkippedTiles(0)
+ {
+ }
+
+template <class TLabelFilter>
+void
+SparseLabelImageFileWriter<TLabelFilter>
+::Update()
+ {
+  if (m_LabelFilter.IsNull())
+    {
+    itkExceptionMacro(<< "No label filter to write");
+    }
+  if (m_TileSize == 0 || m_TileSize % 16 != 0)
+    {
+    itkExceptionMacro(<< "Tile size must be a non null multiple of 16");
+    }
+
+  this->SetAbortGenerateData(0);
+  this->SetProgress(0.0);
+  this->InvokeEvent(itk::StartEvent());
+
+  // Output information
+  m_LabelFilter->UpdateOutputInformation();
+  ImageType * image = m_LabelFilter->GetOutput();
+  const RegionType largestRegion = image->GetLargestPossibleRegion();
+  const unsigned int nbBands = image->GetNumberOfComponentsPerPixel();
+  const GDALDataType dataType = GdalDataTypeBridge::GetGDALDataType<InternalPixelType>();
+
+  // Create the sparse tiled GeoTIFF
+  GDALAllRegister();
+  GDALDriverH driver = GDALGetDriverByName("GTiff");
+  if (driver == NULL)
+    {
+    itkExceptionMacro(<< "GTiff driver not available");
+    }
+  std::ostringstream blockSize;
+  blockSize << m_TileSize;
+  char ** options = NULL;
+  options = CSLSetNameValue(options, "TILED", "YES");
+  options = CSLSetNameValue(options, "SPARSE_OK", "TRUE");
+  options = CSLSetNameValue(options, "BLOCKXSIZE", blockSize.str().c_str());
+  options = CSLSetNameValue(options, "BLOCKYSIZE", blockSize.str().c_str());
+  for (unsigned int i = 0; i < m_CreationOptions.size(); i++)
+    {
+    options = CSLAddString(options, m_CreationOptions[i].c_str());
+    }
+  GDALDatasetH dataset = GDALCreate(driver, m_FileName.c_str(),
+      largestRegion.GetSize()[0], largestRegion.GetSize()[1], nbBands, dataType, options);
+  CSLDestroy(options);
+  if (dataset == NULL)
+    {
+    itkExceptionMacro(<< "Unable to create " << m_FileName);
+    }
+
+  // Projection and geotransform (GDAL origin is the corner of the first pixel)
+  GDALSetProjection(dataset, image->GetProjectionRef().c_str());
+  double geoTransform[6];
+  geoTransform[0] = image->GetOrigin()[0] - 0.5 * image->GetSignedSpacing()[0];
+  geoTransform[3] = image->GetOrigin()[1] - 0.5 * image->GetSignedSpacing()[1];
+  geoTransform[1] = image->GetSignedSpacing()[0];
+  geoTransform[5] = image->GetSignedSpacing()[1];
+  geoTransform[2] = 0.;
+  geoTransform[4] = 0.;
+  GDALSetGeoTransform(dataset, geoTransform);
+
+  // Write the tiles touched by the geometries
+  m_NumberOfWrittenTiles = 0;
+  m_NumberOfSkippedTiles = 0;
+  const unsigned long nbTilesX = (largestRegion.GetSize()[0] + m_TileSize - 1) / m_TileSize;
+  const unsigned long nbTilesY = (largestRegion.GetSize()[1] + m_TileSize - 1) / m_TileSize;
+  const int pixelSpace = sizeof(InternalPixelType) * nbBands;
+  for (unsigned long ty = 0; ty < nbTilesY && !this->GetAbortGenerateData(); ty++)
+    {
+    for (unsigned long tx = 0; tx < nbTilesX; tx++)
+      {
+      RegionType tile;
+      IndexType tileIndex;
+      SizeType tileSize;
+      tileIndex[0] = largestRegion.GetIndex()[0] + tx * m_TileSize;
+      tileIndex[1] = largestRegion.GetIndex()[1] + ty * m_TileSize;
+      tileSize.Fill(m_TileSize);
+      tile.SetIndex(tileIndex);
+      tile.SetSize(tileSize);
+      tile.Crop(largestRegion);
+
+      if (m_LabelFilter->IsRegionEmpty(tile))
+        {
+        m_NumberOfSkippedTiles++;
+        continue;
+        }
+
+      image->SetRequestedRegion(tile);
+      image->PropagateRequestedRegion();
+      image->UpdateOutputData();
+
+      // Write the tile from the buffer
+      const RegionType bufferedRegion = image->GetBufferedRegion();
+      const InternalPixelType * buffer = image->GetBufferPointer() + nbBands * image->ComputeOffset(tile.GetIndex());
+      CPLErr err = GDALDatasetRasterIO(dataset, GF_Write,
+          tile.GetIndex()[0] - largestRegion.GetIndex()[0],
+          tile.GetIndex()[1] - largestRegion.GetIndex()[1],
+          tile.GetSize()[0], tile.GetSize()[1],
+          const_cast<InternalPixelType *>(buffer),
+          tile.GetSize()[0], tile.GetSize()[1], dataType,
+          nbBands, NULL,
+          pixelSpace, pixelSpace * bufferedRegion.GetSize()[0], sizeof(InternalPixelType));
+      if (err != CE_None)
+        {
+        GDALClose(dataset);
+        itkExceptionMacro(<< "Unable to write the tile " << tile << " in " << m_FileName);
+        }
+      m_NumberOfWrittenTiles++;
+      }
+    this->UpdateProgress( static_cast<float>(ty + 1) / nbTilesY );
+    }
+
+  GDALClose(dataset);
+
+  otbMsgDevMacro(<< m_NumberOfWrittenTiles << " tiles written, " << m_NumberOfSkippedTiles << " tiles skipped");
+
+  this->InvokeEvent(itk::EndEvent());
+ }
+
+} // end namespace otb
+
+#endif /* otbSparseLabelImageFileWriter_txx_ */
@@ -0,0 +1,219 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef otbSpatialReferenceCache_H_
+#define otbSpatialReferenceCache_H_
+
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+
+#include "gdal.h"
+#include "ogr_spatialref.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <utility>
+
+namespace otb {
+
+/* \class SpatialReferenceCache
+ * \brief Process-wide cache of canonicalized spatial reference systems and
+ * of coordinate transformations.
+ *
+ * Each WKT is canonicalized once (EPSG code when it can be identified, PROJ.4
+ * string otherwise), and each distinct canonical SRS gets a unique
+ * sequential id, so that equivalent SRS written differently get the same id,
+ * and SRS equality is an integer comparison.
+ * Coordinate transformations are created per pair of SRS, then reused.
+ * Since a transformation is not thread safe, Transform() hands each caller a
+ * transformation that no other thread uses, so that concurrent callers
+ * transform their points in parallel.
+ *
+ *  \ingroup SimpleExtractionTools
+ */
+class SpatialReferenceCache{
+public:
+
+  typedef size_t                                            SRSIdType;
+  typedef std::pair<SRSIdType, SRSIdType>                   SRSPairType;
+
+  /*
+   * Returns the id of the canonicalized SRS (0 for an empty WKT)
+   */
+  static SRSIdType GetSRSId(const std::string & wkt)
+  {
+    if (wkt.empty())
+      return 0;
+
+    Instance & instance = GetInstance();
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(instance.m_Mutex);
+    return GetSRSIdLocked(instance, wkt);
+  }
+
+  /*
+   * Returns the ids of two SRS, taking the lock once
+   */
+  static SRSPairType GetSRSIds(const std::string & wkt1, const std::string & wkt2)
+  {
+    Instance & instance = GetInstance();
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(instance.m_Mutex);
+    return SRSPairType(wkt1.empty() ? 0 : GetSRSIdLocked(instance, wkt1),
+                       wkt2.empty() ? 0 : GetSRSIdLocked(instance, wkt2));
+  }
+
+  /*
+   * Transforms n points from the source SRS to the target SRS. Returns the
+   * number of successfully transformed points, success[i] tells which ones.
+   */
+  static int Transform(const std::string & sourceWkt, const std::string & targetWkt,
+      int n, double * x, double * y, int * success)
+  {
+    const SRSPairType key = GetSRSIds(sourceWkt, targetWkt);
+
+    for (int i = 0; i < n; i++)
+      success[i] = 0;
+
+    // Same SRS: nothing to do
+    if (key.first != 0 && key.first == key.second)
+      {
+      for (int i = 0; i < n; i++)
+        success[i] = 1;
+      return n;
+      }
+
+    // Take a transformation of the pair out of the cache (the map is only
+    // accessed under the lock, the transformations are used outside of it)
+    Instance & instance = GetInstance();
+    OGRCoordinateTransformation * transform = ITK_NULLPTR;
+    {
+      itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(instance.m_Mutex);
+      if (instance.m_InvalidPairs.count(key) > 0)
+        return 0;
+      std::vector<OGRCoordinateTransformation*> & available = instance.m_Transforms[key];
+      if (!available.empty())
+        {
+        transform = available.back();
+        available.pop_back();
+        }
+    }
+
+    // No available transformation: create one
+    if (transform == ITK_NULLPTR)
+      {
+      OGRSpatialReference sourceSRS, targetSRS;
+      if (Import(sourceSRS, sourceWkt) && Import(targetSRS, targetWkt))
+        transform = OGRCreateCoordinateTransformation(&sourceSRS, &targetSRS);
+      if (transform == ITK_NULLPTR)
+        {
+        itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(instance.m_Mutex);
+        instance.m_InvalidPairs.insert(key);
+        return 0;
+        }
+      }
+
+    int nbOfSuccess = 0;
+    transform->Transform(n, x, y, ITK_NULLPTR, success);
+    for (int i = 0; i < n; i++)
+      if (success[i])
+        nbOfSuccess++;
+
+    // Give the transformation back to the cache
+    {
+      itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(instance.m_Mutex);
+      instance.m_Transforms[key].push_back(transform);
+    }
+    return nbOfSuccess;
+  }
+
+private:
+
+  /*
+   * The instance is never destroyed, nor its transformations (at most one per
+   * concurrent caller and pair of SRS): destroying them during the static
+   * destruction could happen after GDAL/PROJ have been cleaned up.
+   */
+  struct Instance
+  {
+    itk::SimpleFastMutexLock                                            m_Mutex;
+    std::map<std::string, SRSIdType>                                    m_Ids;
+    std::map<std::string, SRSIdType>                                    m_CanonicalIds;
+    std::map<SRSPairType, std::vector<OGRCoordinateTransformation*> >   m_Transforms;
+    std::set<SRSPairType>                                               m_InvalidPairs;
+  };
+
+  static SRSIdType GetSRSIdLocked(Instance & instance, const std::string & wkt)
+  {
+    std::map<std::string, SRSIdType>::const_iterator it = instance.m_Ids.find(wkt);
+    if (it != instance.m_Ids.end())
+      return it->second;
+
+    // Ids of the canonical SRS start at 1
+    const std::string canonical = Canonicalize(wkt);
+    std::map<std::string, SRSIdType>::const_iterator cit = instance.m_CanonicalIds.find(canonical);
+    SRSIdType id;
+    if (cit != instance.m_CanonicalIds.end())
+      {
+      id = cit->second;
+      }
+    else
+      {
+      id = instance.m_CanonicalIds.size() + 1;
+      instance.m_CanonicalIds[canonical] = id;
+      }
+    instance.m_Ids[wkt] = id;
+    return id;
+  }
+
+  static Instance & GetInstance()
+  {
+    static Instance * instance = new Instance;
+    return *instance;
+  }
+
+  static bool Import(OGRSpatialReference & srs, const std::string & wkt)
+  {
+    if (srs.SetFromUserInput(wkt.c_str()) != OGRERR_NONE)
+      return false;
+#if GDAL_VERSION_NUM >= 3000000
+    // Keep the x/y (easting/northing, longitude/latitude) order
+    srs.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+    return true;
+  }
+
+  static std::string Canonicalize(const std::string & wkt)
+  {
+    OGRSpatialReference srs;
+    if (!Import(srs, wkt))
+      return wkt;
+
+    // EPSG code if it can be found
+    srs.AutoIdentifyEPSG();
+    const char * authority = srs.GetAuthorityName(ITK_NULLPTR);
+    const char * code = srs.GetAuthorityCode(ITK_NULLPTR);
+    if (authority != ITK_NULLPTR && code != ITK_NULLPTR)
+      return std::string(authority) + ":" + std::string(code);
+
+    // PROJ.4 string otherwise
+    char * proj4 = ITK_NULLPTR;
+    std::string canonical(wkt);
+    if (srs.exportToProj4(&proj4) == OGRERR_NONE && proj4 != ITK_NULLPTR)
+      canonical = proj4;
+    CPLFree(proj4);
+    return canonical;
+  }
+
+};
+
+}
+
+#endif /* otbSpatialReferenceCache_H_ */
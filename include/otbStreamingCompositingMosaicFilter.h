@@ -0,0 +1,139 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef StreamingCompositingMosaicFilter_H_
+#define StreamingCompositingMosaicFilter_H_
+
+#include "otbStreamingMosaicFilterBase.h"
+#include "itkImageRegionIterator.h"
+#include "itkProgressReporter.h"
+
+#include <vector>
+#include <utility>
+
+namespace otb
+{
+
+/**
+ * \class StreamingCompositingMosaicFilter
+ * \brief Computes a mosaic of the input images, compositing overlapping
+ * pixels in one single pass.
+ *
+ * For each output pixel, the valid (i.e. not empty) pixels of the input
+ * images are combined with the selected strategy:
+ *  - FIRST_VALID: the first valid pixel in the inputs order,
+ *  - LAST_VALID: the last valid pixel in the inputs order (same as
+ *    StreamingSimpleMosaicFilter),
+ *  - MAX: the per-band maximum of the valid pixels,
+ *  - MEAN: the per-band mean of the valid pixels,
+ *  - PRIORITY: the valid pixel of the input with the highest priority (see
+ *    SetInputPriorities()). Ties are resolved as LAST_VALID.
+ *
+ * As in StreamingSimpleMosaicFilter, pixels with no valid input get the
+ * no-data output value (SetNoDataOutputPixel()), and input values are
+ * shift-scaled before compositing when SetShiftScaleInputImages() is on.
+ *
+ * \ingroup SimpleExtractionTools
+ */
+template <class TInputImage, class TOutputImage=TInputImage, class TInternalValueType=double>
+class ITK_EXPORT StreamingCompositingMosaicFilter :
+public otb::StreamingMosaicFilterBase<TInputImage, TOutputImage, TInternalValueType>
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef StreamingCompositingMosaicFilter                    Self;
+  typedef otb::StreamingMosaicFilterBase<
+      TInputImage, TOutputImage, TInternalValueType>          Superclass;
+  typedef itk::SmartPointer<Self>                             Pointer;
+  typedef itk::SmartPointer<const Self>                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(StreamingCompositingMosaicFilter, StreamingMosaicFilterBase);
+
+  /** Input image typedefs.  */
+  typedef typename Superclass::InputImageType              InputImageType;
+  typedef typename Superclass::InputImagePointer           InputImagePointer;
+  typedef typename Superclass::InputImagePixelType         InputImagePixelType;
+
+  /** Output image typedefs.  */
+  typedef typename Superclass::OutputImageType              OutputImageType;
+  typedef typename Superclass::OutputImagePointType         OutputImagePointType;
+  typedef typename Superclass::OutputImagePixelType         OutputImagePixelType;
+  typedef typename Superclass::OutputImageInternalPixelType OutputImageInternalPixelType;
+  typedef typename Superclass::OutputImageRegionType        OutputImageRegionType;
+
+  /** Internal computing typedef support. */
+  typedef typename Superclass::InternalValueType            InternalValueType;
+  typedef typename Superclass::InterpolatorPointerType      InterpolatorPointerType;
+  typedef typename itk::VariableLengthVector<
+      InternalValueType>                                    AccumulatorPixelType;
+
+  /** Iterator typedefs */
+  typedef typename itk::ImageRegionIterator<OutputImageType> IteratorType;
+
+  /** Compositing strategies */
+  typedef enum
+  {
+    FIRST_VALID,
+    LAST_VALID,
+    MAX,
+    MEAN,
+    PRIORITY
+  } CompositingStrategyType;
+
+  itkSetMacro(CompositingStrategy, CompositingStrategyType);
+  itkGetMacro(CompositingStrategy, CompositingStrategyType);
+
+  /** Priority of each input image (used with the PRIORITY strategy) */
+  void SetInputPriorities(const std::vector<double> & priorities)
+  {
+    m_InputPriorities = priorities;
+    this->Modified();
+  }
+  const std::vector<double> & GetInputPriorities() const { return m_InputPriorities; }
+
+protected:
+  StreamingCompositingMosaicFilter();
+  virtual ~StreamingCompositingMosaicFilter() {}
+
+  /** Overrided methods */
+  virtual void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread,
+      itk::ThreadIdType threadId );
+
+  /** Returns the priority of the input image */
+  double GetInputPriority(unsigned int imgIndex) const;
+
+  /** Compares (-priority, input) pairs on priority only */
+  static bool PriorityCompare(const std::pair<double, unsigned int> & a,
+      const std::pair<double, unsigned int> & b)
+  {
+    return a.first < b.first;
+  }
+
+private:
+  StreamingCompositingMosaicFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  CompositingStrategyType m_CompositingStrategy;
+  std::vector<double>     m_InputPriorities;
+
+}; // end of class
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingCompositingMosaicFilter.hxx"
+#endif
+
+#endif /* StreamingCompositingMosaicFilter_H_ */
@@ -0,0 +1,188 @@
+/*=========================================================================
+
+  Copyright (c) Remi Cresson (IRSTEA). All rights reserved.
+
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef __StreamingCompositingMosaicFilter_hxx
+#define __StreamingCompositingMosaicFilter_hxx
+
+#include "otbStreamingCompositingMosaicFilter.h"
+
+#include <algorithm>
+
+namespace otb
+{
+
+template <class TInputImage, class TOutputImage, class TInternalValueType>
+StreamingCompositingMosaicFilter<TInputImage, TOutputImage, TInternalValueType>
+::StreamingCompositingMosaicFilter()
+ {
+  m_CompositingStrategy = LAST_VALID;
+ }
+
+template <class TInputImage, class TOutputImage, class TInternalValueType>
+double
+StreamingCompositingMosaicFilter<TInputImage, TOutputImage, TInternalValueType>
+::GetInputPriority(unsigned int imgIndex) const
+ {
+  if (imgIndex < m_InputPriorities.size())
+    {
+    return m_InputPriorities[imgIndex];
+    }
+  return 0.0;
+ }
+
+/**
+ * Processing
+ */
+template <class TInputImage, class TOutputImage, class TInternalValueType>
+void
+StreamingCompositingMosaicFilter<TInputImage, TOutputImage, TInternalValueType>
+::ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, itk::ThreadIdType threadId)
+ {
+
+  // Support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels() );
+
+  // Get output pointer
+  OutputImageType * mosaicImage = this->GetOutput();
+
+  // Get number of used inputs
+  const unsigned int nbOfUsedInputImages = Superclass::GetNumberOfUsedInputImages();
+
+  // Get number of bands
+  const unsigned int nBands = Superclass::GetNumberOfBands();
+
+  // Iterate through the thread region
+  IteratorType outputIt(mosaicImage, outputRegionForThread);
+
+  // Prepare input pointers, interpolators, and valid regions (input images)
+  typename std::vector<InputImageType *>        currentImage;
+  typename std::vector<InterpolatorPointerType> interp;
+  Superclass::PrepareImageAccessors(currentImage, interp);
+
+  // Order in which the used input images are visited. For the strategies
+  // keeping only one pixel, the visit stops at the first valid pixel.
+  std::vector<unsigned int> order;
+  for (unsigned int i = 0 ; i < nbOfUsedInputImages ; i++)
+    {
+    order.push_back(i);
+    }
+  if (m_CompositingStrategy == LAST_VALID || m_CompositingStrategy == PRIORITY)
+    {
+    std::reverse(order.begin(), order.end());
+    }
+  if (m_CompositingStrategy == PRIORITY)
+    {
+    // Highest priority first. Stable sort of the reversed order, so that
+    // the last input wins among equal priorities
+    std::vector<std::pair<double, unsigned int> > priorities;
+    for (unsigned int k = 0 ; k < order.size() ; k++)
+      {
+      priorities.push_back(std::make_pair(
+          -GetInputPriority(Superclass::GetUsedInputImageIndice(order[k])), order[k]));
+      }
+    std::stable_sort(priorities.begin(), priorities.end(), PriorityCompare);
+    for (unsigned int k = 0 ; k < order.size() ; k++)
+      {
+      order[k] = priorities[k].second;
+      }
+    }
+  const bool accumulate = (m_CompositingStrategy == MAX || m_CompositingStrategy == MEAN);
+
+  // Container for geo coordinates
+  OutputImagePointType geoPoint;
+
+  // Per-pixel accumulator
+  AccumulatorPixelType accumulator(nBands);
+
+  for ( outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt )
+    {
+    // Prepare output pixel
+    OutputImagePixelType outputPixel = Superclass::GetNoDataOutputPixel();
+
+    // Current pixel --> Geographical point
+    mosaicImage->TransformIndexToPhysicalPoint (outputIt.GetIndex(), geoPoint) ;
+
+    accumulator.Fill(0.0);
+    unsigned int count = 0;
+
+    // Loop on used input images
+    for (unsigned int k = 0 ; k < order.size() ; k++)
+      {
+      const unsigned int i = order[k];
+
+      // Check if the point is inside the transformed thread region
+      if (interp[i]->IsInsideBuffer(geoPoint) )
+        {
+
+        // Compute the interpolated pixel value
+        InputImagePixelType interpolatedPixel = interp[i]->Evaluate(geoPoint);
+
+        // Check that interpolated pixel is not empty
+        if (Superclass::IsPixelNotEmpty(interpolatedPixel) )
+          {
+          for (unsigned int band = 0 ; band < nBands ; band++)
+            {
+            InternalValueType value = static_cast<InternalValueType>(interpolatedPixel[band]);
+
+            // Shift-scale the value
+            if (Superclass::GetShiftScaleInputImages() )
+              {
+              this->ShiftScaleValue(value, Superclass::GetUsedInputImageIndice(i), band);
+              }
+
+            if (!accumulate)
+              {
+              outputPixel[band] = static_cast<OutputImageInternalPixelType>(value);
+              }
+            else if (m_CompositingStrategy == MEAN)
+              {
+              accumulator[band] += value;
+              }
+            else if (count == 0 || value > accumulator[band])
+              {
+              accumulator[band] = value;
+              }
+            }
+          if (!accumulate)
+            {
+            break;
+            }
+          count++;
+
+          } // Interpolated pixel is not empty
+        }   // point inside buffer
+      }     // next image
+
+    if (accumulate && count > 0)
+      {
+      for (unsigned int band = 0 ; band < nBands ; band++)
+        {
+        InternalValueType value = accumulator[band];
+        if (m_CompositingStrategy == MEAN)
+          {
+          value /= static_cast<InternalValueType>(count);
+          }
+        outputPixel[band] = static_cast<OutputImageInternalPixelType>(value);
+        }
+      }
+
+    // Update output pixel value
+    outputIt.Set(outputPixel);
+
+    // Update progress
+    progress.CompletedPixel();
+
+    } // next output pixel
+
+ }
+
+} // end namespace otb
+
+#endif
@@ -16,6 +16,7 @@
 #include "otbMacro.h"
 #include "otbImageMetadataInterfaceFactory.h"
 #include "otbVectorData.h"
+#include "otbPerformanceRecorder.h"
 
 #include "gdal.h"
 #include "ogr_api.h"
@@ -39,6 +40,13 @@ namespace otb {
  *
  *  OGRRegisterAll() method must have been called before applying filter.
  *
+ *  The envelopes of the geometries are kept, so that only the geometries
+ *  touching the requested region are burnt. IsRegionEmpty() tells if no
+ *  geometry touches a region of the output, so that a writer can skip it
+ *  (see SparseLabelImageFileWriter). Envelopes are indexed on a grid of cells
+ *  of the output, so that both queries only visit the geometries of the cells
+ *  covered by the region.
+ *
  * \ingroup SimpleExtractionTools
  */
 template <class TVectorData, class TOutputImage  >
@@ -120,6 +128,14 @@ public:
   /** Useful to set the output parameters from an existing image*/
   void SetOutputParametersFromImage(const ImageBaseType * image);
 
+  /** Returns true if no geometry touches the region of the output.
+   * Output information must have been generated before. */
+  bool IsRegionEmpty(const OutputImageRegionType & region) const;
+
+  /** Optional performance recorder */
+  itkSetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+  itkGetObjectMacro(PerformanceRecorder, PerformanceRecorder);
+
 protected:
   virtual void GenerateData();
 
@@ -130,6 +146,19 @@ protected:
 
   void PrintSelf(std::ostream& os, itk::Indent indent) const;
 
+  /** Physical extent of a region of the output */
+  OGREnvelope RegionToEnvelope(const OutputImageRegionType & region) const;
+
+  /** Builds the grid index of the geometries envelopes */
+  void BuildSpatialIndex();
+
+  /** Range of the index cells covered by an envelope. Returns false if the
+   * envelope is outside the output */
+  bool EnvelopeToCells(const OGREnvelope & envelope, unsigned long cells[4]) const;
+
+  /** Range of the index cells covered by a region of the output */
+  void RegionToCells(const OutputImageRegionType & region, unsigned long cells[4]) const;
+
 private:
   VectorDataToLabelImageCustomFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -138,6 +167,12 @@ private:
 
   // Vector Of OGRGeometyH
   std::vector< OGRGeometryH >   m_SrcDataSetGeometries;
+  std::vector< OGREnvelope >    m_SrcDataSetEnvelopes;
+
+  // Grid index of the envelopes: geometries of each cell of the output
+  unsigned int                  m_IndexCellSize;
+  unsigned long                 m_IndexGridSize[2];
+  std::vector< std::vector<unsigned int> > m_IndexCells;
 
   std::vector<double>           m_BurnValues;
   std::vector<double>           m_FullBurnValues;
@@ -158,6 +193,9 @@ private:
   OutputOriginType              m_OutputOrigin;
   OutputSizeType                m_OutputSize;
   OutputIndexType               m_OutputStartIndex;
+
+  // Performance recorder
+  PerformanceRecorder::Pointer  m_PerformanceRecorder;
 }; // end of class VectorDataToLabelImageCustomFilter
 
 } // end of namespace otb
@@ -21,15 +21,22 @@
 
 #include "itkImageRegionIterator.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace otb
 {
 template<class TVectorData, class TOutputImage>
 VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
 ::VectorDataToLabelImageCustomFilter()
  : m_OGRDataSourcePointer(0),
+   m_IndexCellSize(256),
    m_BurnAttribute("FID"),
    m_BurnMaxValueMode(false)
    {
+  m_IndexGridSize[0] = 0;
+  m_IndexGridSize[1] = 0;
+
   this->SetNumberOfRequiredInputs(1);
 
   // Output parameters initialization
@@ -151,6 +158,9 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
   itk::EncapsulateMetaData<std::string> (dict, otb::MetaDataKey::ProjectionRefKey,
       static_cast<std::string>(this->GetOutputProjectionRef()));
 
+  PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "VectorDataToLabelImageCustomFilter",
+      "convert");
+
   // Generate the OGRLayers from the input VectorDatas
   // iteration begin from 1 cause the 0th input is a image
   for (unsigned int inputIdx = 0; inputIdx < this->GetNumberOfInputs(); ++inputIdx)
@@ -217,6 +227,10 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
           hGeom = OGR_G_Clone( OGR_F_GetGeometryRef( hFeat ) );
           m_SrcDataSetGeometries.push_back( hGeom );
 
+          OGREnvelope envelope;
+          OGR_G_GetEnvelope( hGeom, &envelope );
+          m_SrcDataSetEnvelopes.push_back( envelope );
+
           if (m_BurnMaxValueMode)
             {
             m_FullBurnValues.push_back(static_cast<double>(itk::NumericTraits<OutputImageInternalPixelType>::max()));
@@ -246,6 +260,10 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
         }
       }
     }
+
+  BuildSpatialIndex();
+
+  event.SetFeatures(m_SrcDataSetGeometries.size());
  }
 
 template<class TVectorData, class TOutputImage>
@@ -254,15 +272,58 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>::GenerateData()
 {
   // Call Superclass GenerateData
   this->AllocateOutputs();
-  itk::ImageRegionIterator<TOutputImage> it (this->GetOutput(), this->GetOutput()->GetBufferedRegion());
-  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
-    {
-    it.Set(0);
-    }
+  this->GetOutput()->FillBuffer(0);
 
   // Get the buffered region
   OutputImageRegionType bufferedRegion = this->GetOutput()->GetBufferedRegion();
 
+  PerformanceRecorder::ScopedEvent event(m_PerformanceRecorder, "VectorDataToLabelImageCustomFilter",
+      "rasterize");
+  event.SetPixels(bufferedRegion.GetNumberOfPixels());
+  if (m_PerformanceRecorder)
+    {
+    m_PerformanceRecorder->UpdatePeakBufferBytes("VectorDataToLabelImageCustomFilter",
+        bufferedRegion.GetNumberOfPixels() * this->GetOutput()->GetNumberOfComponentsPerPixel()
+        * sizeof(OutputImageInternalPixelType));
+    }
+
+  // Candidate geometries from the index cells covered by the buffered
+  // region, in the input order (which is the burning order)
+  std::vector<unsigned int> candidates;
+  if (!m_IndexCells.empty())
+    {
+    unsigned long cells[4];
+    RegionToCells(bufferedRegion, cells);
+    for (unsigned long cy = cells[2]; cy <= cells[3]; cy++)
+      for (unsigned long cx = cells[0]; cx <= cells[1]; cx++)
+        {
+        const std::vector<unsigned int> & cell = m_IndexCells[cy * m_IndexGridSize[0] + cx];
+        candidates.insert(candidates.end(), cell.begin(), cell.end());
+        }
+    }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  // Keep only the geometries touching the buffered region
+  const OGREnvelope bufferedEnvelope = RegionToEnvelope(bufferedRegion);
+  std::vector< OGRGeometryH > geometries;
+  std::vector<double>         burnValues;
+  for (unsigned int k = 0; k < candidates.size(); k++)
+    {
+    const unsigned int i = candidates[k];
+    if (m_SrcDataSetEnvelopes[i].Intersects(bufferedEnvelope))
+      {
+      geometries.push_back(m_SrcDataSetGeometries[i]);
+      burnValues.push_back(m_FullBurnValues[i]);
+      }
+    }
+  event.SetFeatures(geometries.size());
+  if (geometries.empty())
+    {
+    // Nothing to burn
+    return;
+    }
+
   // nb bands
   unsigned int nbBands =  this->GetOutput()->GetNumberOfComponentsPerPixel();
 
@@ -308,9 +369,9 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>::GenerateData()
     {
     GDALRasterizeGeometries( dataset, m_BandsToBurn.size(),
         &(m_BandsToBurn[0]),
-        m_SrcDataSetGeometries.size(),
-        &(m_SrcDataSetGeometries[0]),
-        NULL, NULL, &(m_FullBurnValues[0]),
+        geometries.size(),
+        &(geometries[0]),
+        NULL, NULL, &(burnValues[0]),
         NULL,
         GDALDummyProgress, NULL );
 
@@ -319,6 +380,120 @@ VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>::GenerateData()
     }
 }
 
+template<class TVectorData, class TOutputImage>
+OGREnvelope
+VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
+::RegionToEnvelope(const OutputImageRegionType & region) const
+ {
+  // Pixels extent of the region
+  OGREnvelope envelope;
+  const double x0 = m_OutputOrigin[0] + (region.GetIndex()[0] - 0.5) * m_OutputSpacing[0];
+  const double x1 = m_OutputOrigin[0] + (region.GetIndex()[0] + region.GetSize()[0] - 0.5) * m_OutputSpacing[0];
+  const double y0 = m_OutputOrigin[1] + (region.GetIndex()[1] - 0.5) * m_OutputSpacing[1];
+  const double y1 = m_OutputOrigin[1] + (region.GetIndex()[1] + region.GetSize()[1] - 0.5) * m_OutputSpacing[1];
+  envelope.MinX = std::min(x0, x1);
+  envelope.MaxX = std::max(x0, x1);
+  envelope.MinY = std::min(y0, y1);
+  envelope.MaxY = std::max(y0, y1);
+  return envelope;
+ }
+
+template<class TVectorData, class TOutputImage>
+bool
+VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
+::IsRegionEmpty(const OutputImageRegionType & region) const
+ {
+  if (m_IndexCells.empty())
+    {
+    return true;
+    }
+
+  const OGREnvelope regionEnvelope = RegionToEnvelope(region);
+  unsigned long cells[4];
+  RegionToCells(region, cells);
+  for (unsigned long cy = cells[2]; cy <= cells[3]; cy++)
+    for (unsigned long cx = cells[0]; cx <= cells[1]; cx++)
+      {
+      const std::vector<unsigned int> & cell = m_IndexCells[cy * m_IndexGridSize[0] + cx];
+      for (unsigned int k = 0; k < cell.size(); k++)
+        {
+        if (m_SrcDataSetEnvelopes[cell[k]].Intersects(regionEnvelope))
+          {
+          return false;
+          }
+        }
+      }
+  return true;
+ }
+
+template<class TVectorData, class TOutputImage>
+void
+VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
+::BuildSpatialIndex()
+ {
+  m_IndexGridSize[0] = std::max(1ul, (static_cast<unsigned long>(m_OutputSize[0]) + m_IndexCellSize - 1) / m_IndexCellSize);
+  m_IndexGridSize[1] = std::max(1ul, (static_cast<unsigned long>(m_OutputSize[1]) + m_IndexCellSize - 1) / m_IndexCellSize);
+  m_IndexCells.assign(m_IndexGridSize[0] * m_IndexGridSize[1], std::vector<unsigned int>());
+
+  unsigned long cells[4];
+  for (unsigned int i = 0; i < m_SrcDataSetEnvelopes.size(); i++)
+    {
+    if (!EnvelopeToCells(m_SrcDataSetEnvelopes[i], cells))
+      {
+      continue;
+      }
+    for (unsigned long cy = cells[2]; cy <= cells[3]; cy++)
+      for (unsigned long cx = cells[0]; cx <= cells[1]; cx++)
+        {
+        m_IndexCells[cy * m_IndexGridSize[0] + cx].push_back(i);
+        }
+    }
+ }
+
+template<class TVectorData, class TOutputImage>
+bool
+VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
+::EnvelopeToCells(const OGREnvelope & envelope, unsigned long cells[4]) const
+ {
+  // Continuous pixel coordinates of the envelope (the origin is the center of
+  // the first pixel)
+  const double x0 = (envelope.MinX - m_OutputOrigin[0]) / m_OutputSpacing[0] + 0.5;
+  const double x1 = (envelope.MaxX - m_OutputOrigin[0]) / m_OutputSpacing[0] + 0.5;
+  const double y0 = (envelope.MinY - m_OutputOrigin[1]) / m_OutputSpacing[1] + 0.5;
+  const double y1 = (envelope.MaxY - m_OutputOrigin[1]) / m_OutputSpacing[1] + 0.5;
+
+  // Pixels range, with a margin of one pixel for the envelopes touching the
+  // borders of the pixels
+  const double colMin = std::floor(std::min(x0, x1)) - 1;
+  const double colMax = std::floor(std::max(x0, x1)) + 1;
+  const double rowMin = std::floor(std::min(y0, y1)) - 1;
+  const double rowMax = std::floor(std::max(y0, y1)) + 1;
+  if (colMax < 0 || rowMax < 0 || colMin >= m_OutputSize[0] || rowMin >= m_OutputSize[1])
+    {
+    return false;
+    }
+
+  cells[0] = static_cast<unsigned long>(std::max(0.0, colMin)) / m_IndexCellSize;
+  cells[1] = static_cast<unsigned long>(std::min(static_cast<double>(m_OutputSize[0] - 1), colMax)) / m_IndexCellSize;
+  cells[2] = static_cast<unsigned long>(std::max(0.0, rowMin)) / m_IndexCellSize;
+  cells[3] = static_cast<unsigned long>(std::min(static_cast<double>(m_OutputSize[1] - 1), rowMax)) / m_IndexCellSize;
+  return true;
+ }
+
+template<class TVectorData, class TOutputImage>
+void
+VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>
+::RegionToCells(const OutputImageRegionType & region, unsigned long cells[4]) const
+ {
+  for (unsigned int dim = 0; dim < 2; dim++)
+    {
+    const long start = std::max(0l, static_cast<long>(region.GetIndex()[dim]));
+    const long end = std::max(start, static_cast<long>(region.GetIndex()[dim] + region.GetSize()[dim]) - 1);
+    cells[2 * dim] = std::min(static_cast<unsigned long>(start) / m_IndexCellSize, m_IndexGridSize[dim] - 1);
+    cells[2 * dim + 1] = std::min(static_cast<unsigned long>(end) / m_IndexCellSize, m_IndexGridSize[dim] - 1);
+    }
+ }
+
 template<class TVectorData, class TOutputImage>
 void
 VectorDataToLabelImageCustomFilter<TVectorData, TOutputImage>